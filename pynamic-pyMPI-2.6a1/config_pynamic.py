@@ -12,14 +12,14 @@
 #          configures/builds pyMPI with those libraries.
 #
 
-from so_generator import print_error, parse_and_run, run_command, print_usage
+from so_generator import print_error, parse_and_run, run_command, print_usage, libs_rsp_name
 import sys
 import os
 
 #
 # run the so_generator
 #
-if len(sys.argv) < 3:
+if len(sys.argv) < 3 and (len(sys.argv) < 2 or sys.argv[1].find('--spec=') != 0):
     print_usage('config_pynamic.py')
     sys.exit(1)
 configure_args, python_command, bigexe, use_mpi4py, processes = parse_and_run('config_pynamic.py')
@@ -28,12 +28,12 @@ if not use_mpi4py:
     #
     # configure pyMPI or mpi4py with the pynamic-generated libraries
     #
+    # the module and utility libraries come from a response file, which keeps
+    # the configure command and the link lines short with many modules
     command = './configure --with-prompt-nl --with-isatty --with-python=%s --with-libs="' % (sys.executable)
     command += '-Wl,-rpath=%s ' %(os.getcwd())
-    for p, d, f in os.walk('./'):
-        for file in f:
-            if file.find('.so') != -1 and file.find('lib') != -1:
-                command += '-l' + file[3:file.find('.')] + ' '
+    command += '@%s ' %(os.path.join(os.getcwd(), libs_rsp_name))
+    command += '-lmodulebegin -lmodulefinal'
     command += '" '
     for arg in configure_args:
         command += arg + ' '
@@ -78,6 +78,12 @@ if os.path.exists('./addall.c') != True:
 command = "gcc -g addall.c -o addall"
 run_command(command)
 
+#
+# build the native replacement of the get-symtab-sizes pipeline
+#
+command = "gcc -g -O2 -pthread pynamic_elfstats.c -o pynamic_elfstats"
+run_command(command)
+
 #
 # check DBG, text, symbol table, and string table size.
 #
@@ -87,14 +93,14 @@ if os.path.exists('./get-symtab-sizes') != True:
 
 for exe in ['pynamic-pyMPI', 'pynamic-sdb-pyMPI', 'pynamic-bigexe-pyMPI', 'pynamic-bigexe-sdb-pyMPI', 'pynamic-mpi4py', 'pynamic-bigexe-mpi4py']:
     info_file = 'sharedlib_section_info_%s' %(exe)
-    os.system('rm -f %s' %(info_file))
+    os.system('rm -f %s %s.json' %(info_file, info_file))
     if os.path.exists(exe):
-        command = "./get-symtab-sizes %s > %s" %(exe, info_file)
+        command = "./get-symtab-sizes %s %s.json > %s" %(exe, info_file, info_file)
         ret = run_command(command)
         if ret != 0:
             print_error('Failed to get executable statistics for %s!' %(exe))
         else:
-            command = "tail -10 %s" %(info_file)
+            command = "tail -12 %s" %(info_file)
             run_command(command)
 
 #
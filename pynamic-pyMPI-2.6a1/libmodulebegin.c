@@ -13,8 +13,41 @@ static PyObject *py_libmodulebegin_break_here(PyObject *self, PyObject *args)
     Py_RETURN_NONE;
 }
 
+/* call the --unwind-chain hops whose addresses are in the list argument,
+   returning the time of the backtrace in the last hop and its frames */
+static PyObject *py_libmodulebegin_unwind_chain(PyObject *self, PyObject *args)
+{
+    PyObject *addresses, *sequence;
+    void **chain;
+    int num_hops, i, frames = 0;
+    long ns;
+
+    if (!PyArg_ParseTuple(args, "O", &addresses))
+        return NULL;
+    sequence = PySequence_Fast(addresses, "unwind_chain needs a list of hop addresses");
+    if (sequence == NULL)
+        return NULL;
+    num_hops = (int) PySequence_Fast_GET_SIZE(sequence);
+    if (num_hops == 0) {
+        Py_DECREF(sequence);
+        return Py_BuildValue("(di)", 0.0, 0);
+    }
+    chain = (void **) malloc(num_hops * sizeof(void *));
+    for (i = 0; i < num_hops; i++)
+        chain[i] = PyLong_AsVoidPtr(PySequence_Fast_GET_ITEM(sequence, i));
+    Py_DECREF(sequence);
+    if (PyErr_Occurred()) {
+        free(chain);
+        return NULL;
+    }
+    ns = ((long (*)(void **, int, int, int *)) chain[0])(chain, 0, num_hops, &frames);
+    free(chain);
+    return Py_BuildValue("(di)", ns / 1e9, frames);
+}
+
 static PyMethodDef libmodulebegin_importMethods[] = {
     {"begin_break_here", py_libmodulebegin_break_here, METH_VARARGS, "a function."},
+    {"unwind_chain", py_libmodulebegin_unwind_chain, METH_VARARGS, "call the unwind chain hops."},
     {NULL, NULL, 0, NULL}
 };
 
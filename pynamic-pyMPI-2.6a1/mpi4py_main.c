@@ -33,6 +33,9 @@ int main(int argc, char *argv[])
    MPI_Comm_rank(MPI_COMM_WORLD, &rank);
    printf("rank - %d\n", (int) rank);
    Py_Initialize();
+   /* broadcast the driver and the other Python modules from rank 0 */
+   if (getenv("PYNAMIC_BCAST_SOURCE"))
+      PyRun_SimpleString("import pynamic_bcast\npynamic_bcast.install_source()\n");
    PyRun_SimpleString("import pynamic_driver_mpi4py\n");
    Py_Finalize();
 
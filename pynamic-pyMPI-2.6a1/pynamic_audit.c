@@ -0,0 +1,230 @@
+/*
+ * Please see COPYRIGHT information at the end of this file
+ * File: pynamic_audit.c
+ *
+ * An rtld-audit library that records how long the dynamic loader spends on
+ * every shared object.  Run the driver with
+ *
+ *     LD_AUDIT=<pynamic_dir>/pynamic_audit.so
+ *
+ * and each process writes pynamic_audit.<rank>.<pid>.log to the directory
+ * named by PYNAMIC_AUDIT_DIR (default the current directory).  The log holds
+ * one line per event, with nanoseconds since the process started:
+ *
+ *     search <ns> <flag> <path>          a path the loader tried (la_objsearch)
+ *     open <ns> <id> <lmid> <name>       an object was mapped (la_objopen)
+ *     activity <ns> <add|delete|consistent>
+ *     preinit <ns>                       all startup objects are loaded
+ *     bind <ns> <from_id> <to_id> <sym>  only with PYNAMIC_AUDIT_BINDS set
+ *
+ * followed at exit by one summary line per object:
+ *
+ *     object <id> <searches> <map_ns> <binds_from> <binds_to> <first_bind_ns> <last_bind_ns> <name>
+ *
+ * where <searches> counts the paths tried before the object was found and
+ * <map_ns> the time from its first search to la_objopen.
+ * pynamic_audit_report.py merges the logs of all ranks.
+ */
+
+#define _GNU_SOURCE
+#include <link.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+
+struct audit_object {
+	char *name;
+	long searches;
+	long long map_ns;
+	long binds_from;
+	long binds_to;
+	long long first_bind_ns;
+	long long last_bind_ns;
+};
+
+static FILE *log_file = NULL;
+static long long start_ns = 0;
+static int log_binds = 0;
+
+static struct audit_object *objects = NULL;
+static long num_objects = 0;
+static long max_objects = 0;
+
+/* the searches of the object the loader is currently looking for */
+static long pending_searches = 0;
+static long long pending_start_ns = -1;
+
+static long long now_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec - start_ns;
+}
+
+/* the MPI rank from the environment of the common launchers, or -1 */
+static int mpi_rank()
+{
+	static const char *rank_vars[] = {"PMIX_RANK", "OMPI_COMM_WORLD_RANK", "PMI_RANK",
+					  "MV2_COMM_WORLD_RANK", "SLURM_PROCID", NULL};
+	int i;
+
+	for (i = 0; rank_vars[i] != NULL; i++)
+		if (getenv(rank_vars[i]) != NULL)
+			return atoi(getenv(rank_vars[i]));
+	return -1;
+}
+
+static void open_log()
+{
+	const char *dir = getenv("PYNAMIC_AUDIT_DIR");
+	char path[4096], host[256];
+	struct timespec ts;
+	int rank = mpi_rank();
+
+	if (dir == NULL)
+		dir = ".";
+	snprintf(path, sizeof(path), "%s/pynamic_audit.%d.%d.log", dir, rank, (int) getpid());
+	log_file = fopen(path, "w");
+	if (log_file == NULL)
+		return;
+	setvbuf(log_file, NULL, _IOFBF, 1 << 20);
+	log_binds = getenv("PYNAMIC_AUDIT_BINDS") != NULL;
+	if (gethostname(host, sizeof(host)) != 0)
+		strcpy(host, "unknown");
+	host[sizeof(host) - 1] = '\0';
+	clock_gettime(CLOCK_REALTIME, &ts);
+	fprintf(log_file, "# pynamic_audit rank %d pid %d host %s start %lld.%09ld ppid %d\n",
+		rank, (int) getpid(), host, (long long) ts.tv_sec, ts.tv_nsec, (int) getppid());
+}
+
+unsigned int la_version(unsigned int version)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	start_ns = (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+	open_log();
+	return version < LAV_CURRENT ? version : LAV_CURRENT;
+}
+
+char *la_objsearch(const char *name, uintptr_t *cookie, unsigned int flag)
+{
+	long long ns = now_ns();
+
+	if (flag == LA_SER_ORIG) {
+		pending_searches = 0;
+		pending_start_ns = ns;
+	} else
+		pending_searches++;
+	if (log_file != NULL)
+		fprintf(log_file, "search %lld %u %s\n", ns, flag, name);
+	return (char *) name;
+}
+
+unsigned int la_objopen(struct link_map *map, Lmid_t lmid, uintptr_t *cookie)
+{
+	long long ns = now_ns();
+	struct audit_object *object;
+
+	if (num_objects == max_objects) {
+		long new_max =max_objects == 0 ? 256 : max_objects * 2;
+		struct audit_object *new_objects = realloc(objects, new_max * sizeof(struct audit_object));
+
+		/* keep the objects recorded so far and skip this one */
+		if (new_objects == NULL)
+			return 0;
+		objects = new_objects;
+		max_objects = new_max;
+	}
+	object = &objects[num_objects];
+	memset(object, 0, sizeof(struct audit_object));
+	object->name = strdup(map->l_name[0] != '\0' ? map->l_name : "<main>");
+	object->searches = pending_searches;
+	object->map_ns = pending_start_ns >= 0 ? ns - pending_start_ns : 0;
+	object->first_bind_ns = -1;
+	pending_searches = 0;
+	pending_start_ns = -1;
+
+	/* the cookie is the object's id plus one, so 0 means unknown */
+	*cookie = (uintptr_t) ++num_objects;
+	if (log_file != NULL)
+		fprintf(log_file, "open %lld %ld %ld %s\n", ns, num_objects - 1, (long) lmid, object->name);
+	return LA_FLG_BINDTO | LA_FLG_BINDFROM;
+}
+
+void la_activity(uintptr_t *cookie, unsigned int flag)
+{
+	const char *activity = "consistent";
+
+	if (flag == LA_ACT_ADD)
+		activity = "add";
+	else if (flag == LA_ACT_DELETE)
+		activity = "delete";
+	if (log_file != NULL)
+		fprintf(log_file, "activity %lld %s\n", now_ns(), activity);
+}
+
+void la_preinit(uintptr_t *cookie)
+{
+	if (log_file != NULL)
+		fprintf(log_file, "preinit %lld\n", now_ns());
+}
+
+uintptr_t la_symbind64(Elf64_Sym *sym, unsigned int ndx, uintptr_t *refcook,
+		       uintptr_t *defcook, unsigned int *flags, const char *symname)
+{
+	long long ns = now_ns();
+	long from = (long) *refcook - 1;
+	long to = (long) *defcook - 1;
+
+	if (from >= 0 && from < num_objects) {
+		objects[from].binds_from++;
+		if (objects[from].first_bind_ns < 0)
+			objects[from].first_bind_ns = ns;
+		objects[from].last_bind_ns = ns;
+	}
+	if (to >= 0 && to < num_objects)
+		objects[to].binds_to++;
+	if (log_binds && log_file != NULL)
+		fprintf(log_file, "bind %lld %ld %ld %s\n", ns, from, to, symname);
+	return sym->st_value;
+}
+
+static void __attribute__((destructor)) write_summary()
+{
+	long i;
+
+	if (log_file == NULL)
+		return;
+	for (i = 0; i < num_objects; i++)
+		fprintf(log_file, "object %ld %ld %lld %ld %ld %lld %lld %s\n", i,
+			objects[i].searches, objects[i].map_ns, objects[i].binds_from,
+			objects[i].binds_to, objects[i].first_bind_ns, objects[i].last_bind_ns,
+			objects[i].name);
+	fclose(log_file);
+	log_file = NULL;
+}
+
+/*************************************************
+COPYRIGHT
+
+Copyright (c) 2007, The Regents of the University of California.
+Produced at the Lawrence Livermore National Laboratory
+Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+UCRL-CODE-228991.
+All rights reserved.
+
+This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************/
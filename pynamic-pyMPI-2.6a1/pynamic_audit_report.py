@@ -0,0 +1,167 @@
+#! /usr/bin/env python
+
+# Please see COPYRIGHT information at the end of this file.
+# File: pynamic_audit_report.py
+#
+# Merges the per rank logs pynamic_audit.so writes and reports which shared
+# objects and lookups dominate the loader time across all ranks.  The merged
+# per rank, per object records are written to pynamic_audit_merged.csv.
+#
+# command: python pynamic_audit_report.py [<log_dir>] [-n <num_objects>]
+#
+
+import sys, os
+import re
+
+def print_usage():
+    print('\nUSAGE:\n\tpynamic_audit_report.py [<log_dir>] [options]\n')
+    print('\t<log_dir> = the directory holding the pynamic_audit.<rank>.<pid>.log files,')
+    print('\tdefault the current directory\n')
+    print('OPTIONS:\n')
+    print('-n <num_objects>\n\treport the <num_objects> most expensive objects, default 20\n')
+    sys.exit(-1)
+
+#read one log into its rank, host and the summary record of every object
+def read_log(filename):
+    log = {'rank': -1, 'host': 'unknown', 'pid': 0, 'ppid': 0, 'preinit_ns': None, 'objects': []}
+    f = open(filename, 'r')
+    for line in f:
+        fields = line.split()
+        if len(fields) == 0:
+            continue
+        if fields[0] == '#':
+            m = re.match(r'# pynamic_audit rank (-?\d+) pid (\d+) host (\S+)', line)
+            if m != None:
+                log['rank'] = int(m.group(1))
+                log['pid'] = int(m.group(2))
+                log['host'] = m.group(3)
+            m = re.search(r' ppid (\d+)', line)
+            if m != None:
+                log['ppid'] = int(m.group(1))
+        elif fields[0] == 'preinit':
+            log['preinit_ns'] = int(fields[1])
+        elif fields[0] == 'object' and len(fields) >= 9:
+            record = {'searches': int(fields[2]), 'map_ns': int(fields[3]),
+                      'binds_from': int(fields[4]), 'binds_to': int(fields[5]),
+                      'name': ' '.join(fields[8:])}
+            log['objects'].append(record)
+    f.close()
+    return log
+
+def mean(values):
+    if len(values) == 0:
+        return 0.0
+    return float(sum(values)) / len(values)
+
+#the processes of a rank inherit its rank variables, so a launcher wrapper
+#and the driver's comparison runs log under the same rank.  Keep the process
+#of each rank that loaded the modules and whose parent is not one of the
+#rank's other processes on that host, the one that imported the driver
+def driver_logs(logs):
+    by_rank = {}
+    for log in logs:
+        by_rank.setdefault((log['rank'], log['host']), []).append(log)
+    kept = []
+    for key in sorted(by_rank.keys()):
+        procs = by_rank[key]
+        loaded = [log for log in procs if len([o for o in log['objects'] if os.path.basename(o['name']).startswith('libmodule')]) > 0]
+        if len(loaded) > 0:
+            procs = loaded
+        pids = set([log['pid'] for log in procs])
+        roots = [log for log in procs if log['ppid'] not in pids]
+        kept.append((roots or procs)[0])
+    return kept
+
+def report(logs, num_report, num_all_logs):
+    hosts = sorted(set([log['host'] for log in logs]))
+    print('Pynamic: %d audit logs from %d ranks on %d hosts' %(num_all_logs, len(set([log['rank'] for log in logs])), len(hosts)))
+    if num_all_logs > len(logs):
+        print('Pynamic: reporting the driver process of each rank, %d logs of other processes left out' %(num_all_logs - len(logs)))
+
+    #the loader time of each rank
+    map_totals = [sum([o['map_ns'] for o in log['objects']]) for log in logs]
+    search_totals = [sum([o['searches'] for o in log['objects']]) for log in logs]
+    slowest = logs[map_totals.index(max(map_totals))]
+    print('Pynamic: objects per rank = %d max' %(max([len(log['objects']) for log in logs])))
+    print('Pynamic: search and map time per rank = %.6f secs mean, %.6f secs max (rank %d on %s)' %(mean(map_totals) / 1e9, max(map_totals) / 1e9, slowest['rank'], slowest['host']))
+    print('Pynamic: failed path lookups per rank = %.1f mean, %d max' %(mean(search_totals), max(search_totals)))
+    preinit = [log['preinit_ns'] for log in logs if log['preinit_ns'] != None]
+    if len(preinit) > 0:
+        print('Pynamic: startup objects loaded after %.6f secs mean, %.6f secs max' %(mean(preinit) / 1e9, max(preinit) / 1e9))
+
+    #merge the records of each object over the ranks
+    merged = {}
+    for log in logs:
+        for o in log['objects']:
+            name = os.path.basename(o['name'])
+            if name not in merged:
+                merged[name] = {'searches': [], 'map_ns': [], 'binds_from': [], 'binds_to': []}
+            for key in ['searches', 'map_ns', 'binds_from', 'binds_to']:
+                merged[name][key].append(o[key])
+
+    columns = 'object                                   procs  map ms mean   map ms max  searches  binds from  binds to'
+    for title, key in [('search and map time', 'map_ns'), ('failed path lookups', 'searches'), ('symbol bindings', 'binds_from')]:
+        print('\nPynamic: top %d objects by %s' %(num_report, title))
+        print('Pynamic: ' + columns)
+        names = sorted(merged.keys(), key=lambda name: -max(merged[name][key]))
+        for name in names[:num_report]:
+            m = merged[name]
+            print('Pynamic: %-40s %5d %12.3f %12.3f %9.1f %11.1f %9.1f' %(name[:40], len(m['map_ns']), mean(m['map_ns']) / 1e6, max(m['map_ns']) / 1e6, mean(m['searches']), mean(m['binds_from']), mean(m['binds_to'])))
+
+def write_merged(logs, filename):
+    f = open(filename, 'w')
+    f.write('rank,host,pid,object,searches,map_ns,binds_from,binds_to\n')
+    for log in logs:
+        for o in log['objects']:
+            f.write('%d,%s,%d,%s,%d,%d,%d,%d\n' %(log['rank'], log['host'], log.get('pid', 0), o['name'], o['searches'], o['map_ns'], o['binds_from'], o['binds_to']))
+    f.close()
+
+#MAIN FUNCTION
+if __name__ == '__main__':
+    log_dir = '.'
+    num_report = 20
+    next = 0
+    for i in range(1, len(sys.argv)):
+        if next > 0:
+            next = next - 1
+        elif sys.argv[i] == '-n' and i + 1 < len(sys.argv):
+            num_report = int(sys.argv[i + 1])
+            next = 1
+        elif sys.argv[i].startswith('-'):
+            print('Unknown option %s' %(sys.argv[i]))
+            print_usage()
+        else:
+            log_dir = sys.argv[i]
+
+    logs = []
+    for file in sorted(os.listdir(log_dir)):
+        if re.match(r'pynamic_audit\.-?\d+\.\d+\.log$', file):
+            logs.append(read_log(os.path.join(log_dir, file)))
+    logs = [log for log in logs if len(log['objects']) > 0]
+    if len(logs) == 0:
+        print('no pynamic_audit logs with object records in %s' %(log_dir))
+        sys.exit(-1)
+    logs.sort(key=lambda log: log['rank'])
+
+    report(driver_logs(logs), num_report, len(logs))
+    write_merged(logs, 'pynamic_audit_merged.csv')
+    print('\nPynamic: merged records written to pynamic_audit_merged.csv')
+
+#
+#COPYRIGHT
+#
+#Copyright (c) 2007, The Regents of the University of California.
+#Produced at the Lawrence Livermore National Laboratory
+#Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+#UCRL-CODE-228991.
+#All rights reserved.
+#
+#This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+#
+#Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+#
+#* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+#* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+#* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+#
+#THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,372 @@
+#! /usr/bin/env python
+
+# Please see COPYRIGHT information at the end of this file.
+# File: pynamic_bcast.py
+#
+# An import hook that loads the generated extension modules without every
+# rank reading them from the file system.  Rank 0 reads each library, the
+# bytes are broadcast to all ranks, and each rank writes them to a
+# memfd_create file and dlopens it through /proc/self/fd/<fd>.  The
+# libraries a module needs are loaded the same way first, so the loader
+# finds them by their soname instead of searching the file system.
+#
+# The driver installs the hook when PYNAMIC_BCAST_IMPORT is set:
+#
+#     import pynamic_bcast
+#     finder = pynamic_bcast.install(mpi, pynamic_dir)
+#
+# where mpi is the driver's MPI wrapper.  Every rank must import the same
+# modules in the same order, since each load is a collective operation.
+# The loader knows an object by the path it was opened with, so the memfd
+# of each library stays open for the life of the process and install()
+# raises the soft limit on open files to the hard limit.
+#
+# install_source() adds a second hook for pure Python modules, which
+# mpi4py_main installs before it imports the driver when
+# PYNAMIC_BCAST_SOURCE is set.  Rank 0 finds the module, reads its .pyc if
+# that is up to date or compiles the source, and broadcasts the marshalled
+# code, which every rank executes from memory.  Only modules whose top
+# level name starts with one of source_prefixes, or one of the comma
+# separated prefixes in PYNAMIC_BCAST_MODULES, go through the broadcast.
+#
+
+import sys, os
+import time
+import struct
+import marshal
+
+# only these modules go through the broadcast, everything else is imported
+# from the file system as usual
+bcast_prefixes = ['libmodule', 'libutility']
+source_prefixes = ['pynamic_']
+
+def memfd(name):
+    try:
+        return os.memfd_create(name, 0)
+    except AttributeError:
+        pass
+    #python before 3.8 has no os.memfd_create
+    import ctypes
+    libc = ctypes.CDLL(None, use_errno=True)
+    fd = -1
+    if hasattr(libc, 'memfd_create'):
+        fd = libc.memfd_create(name.encode(), 0)
+    if fd < 0:
+        raise OSError('memfd_create is not available')
+    return fd
+
+#the DT_NEEDED entries of a 64 bit ELF shared library
+def needed_libraries(data):
+    if data[:4] != b'\x7fELF' or data[4:5] != b'\x02':
+        return []
+    endian = '<'
+    if data[5:6] == b'\x02':
+        endian = '>'
+    phoff = struct.unpack_from(endian + 'Q', data, 0x20)[0]
+    phentsize, phnum = struct.unpack_from(endian + 'HH', data, 0x36)
+    loads = []
+    dynamic = None
+    for i in range(phnum):
+        fields = struct.unpack_from(endian + 'IIQQQQQQ', data, phoff + i * phentsize)
+        if fields[0] == 1:
+            loads.append((fields[3], fields[2], fields[5]))
+        elif fields[0] == 2:
+            dynamic = (fields[2], fields[5])
+    if dynamic == None:
+        return []
+    offsets = []
+    strtab = None
+    for offset in range(dynamic[0], dynamic[0] + dynamic[1], 16):
+        tag, value = struct.unpack_from(endian + 'qQ', data, offset)
+        if tag == 0:
+            break
+        elif tag == 1:
+            offsets.append(value)
+        elif tag == 5:
+            strtab = value
+    #DT_STRTAB is an address, find where it is in the file
+    for vaddr, file_offset, size in loads:
+        if strtab != None and vaddr <= strtab < vaddr + size:
+            strtab = strtab - vaddr + file_offset
+            break
+    else:
+        return []
+    needed = []
+    for offset in offsets:
+        start = strtab + offset
+        needed.append(data[start:data.index(b'\0', start)].decode())
+    return needed
+
+#the file names of the shared objects already mapped by this process
+def mapped_libraries():
+    mapped = set()
+    try:
+        f = open('/proc/self/maps', 'r')
+        for line in f:
+            fields = line.split()
+            if len(fields) >= 6 and fields[5].startswith('/'):
+                mapped.add(os.path.basename(fields[5]))
+        f.close()
+    except IOError:
+        pass
+    return mapped
+
+class bcast_finder:
+    def __init__(self, mpi, directory):
+        self.mpi = mpi
+        self.directory = directory
+        self.loaded = mapped_libraries()
+        self.handles = []
+        self.libraries = 0
+        self.bytes = 0
+        self.bcast_time = 0.0
+        self.load_time = 0.0
+
+    #rank 0 reads the library and every rank receives it, None if there is
+    #no such library
+    def receive(self, filename):
+        start = time.time()
+        data = None
+        if self.mpi.rank == 0:
+            path = os.path.join(self.directory, filename)
+            if os.path.isfile(path):
+                f = open(path, 'rb')
+                data = f.read()
+                f.close()
+        data = self.mpi.bcast(data, 0)
+        self.bcast_time += time.time() - start
+        if data != None:
+            self.libraries += 1
+            self.bytes += len(data)
+        return data
+
+    #write data to a memfd and return its /proc/self/fd path
+    def write_memfd(self, filename, data):
+        fd = memfd(filename)
+        view = memoryview(data)
+        while len(view) > 0:
+            view = view[os.write(fd, view):]
+        return '/proc/self/fd/%d' %(fd)
+
+    #load the generated libraries data needs that are not loaded yet
+    def load_needed(self, data):
+        import ctypes
+        for filename in needed_libraries(data):
+            if filename in self.loaded or not filename.startswith('lib'):
+                continue
+            if len([p for p in bcast_prefixes if filename.startswith(p)]) == 0:
+                continue
+            self.loaded.add(filename)
+            needed = self.receive(filename)
+            if needed == None:
+                continue
+            self.load_needed(needed)
+            start = time.time()
+            self.handles.append(ctypes.CDLL(self.write_memfd(filename, needed)))
+            self.load_time += time.time() - start
+
+    def matches(self, name, path):
+        if path != None or name.find('.') != -1:
+            return False
+        if name + '.so' in self.loaded:
+            return False
+        return len([p for p in bcast_prefixes if name.startswith(p)]) > 0
+
+    #receive the module and the libraries it needs, return its memfd path
+    def prepare(self, name):
+        filename = name + '.so'
+        data = self.receive(filename)
+        if data == None:
+            return None
+        self.loaded.add(filename)
+        self.load_needed(data)
+        return self.write_memfd(filename, data)
+
+    def find_spec(self, name, path, target=None):
+        if not self.matches(name, path):
+            return None
+        memfd_path = self.prepare(name)
+        if memfd_path == None:
+            return None
+        import importlib.machinery
+        return importlib.machinery.ModuleSpec(name, bcast_loader(name, memfd_path, self), origin=memfd_path)
+
+    #python 2 import protocol
+    def find_module(self, name, path=None):
+        if not self.matches(name, path):
+            return None
+        memfd_path = self.prepare(name)
+        if memfd_path == None:
+            return None
+        return bcast_loader(name, memfd_path, self)
+
+class bcast_loader:
+    def __init__(self, name, path, finder):
+        self.name = name
+        self.path = path
+        self.finder = finder
+
+    def create_module(self, spec):
+        import importlib.machinery
+        start = time.time()
+        module = importlib.machinery.ExtensionFileLoader(self.name, self.path).create_module(spec)
+        self.finder.load_time += time.time() - start
+        return module
+
+    def exec_module(self, module):
+        import importlib.machinery
+        importlib.machinery.ExtensionFileLoader(self.name, self.path).exec_module(module)
+
+    def load_module(self, name):
+        import imp
+        start = time.time()
+        module = imp.load_dynamic(name, self.path)
+        self.finder.load_time += time.time() - start
+        return module
+
+def install(mpi, directory):
+    try:
+        import resource
+        soft, hard = resource.getrlimit(resource.RLIMIT_NOFILE)
+        if hard == resource.RLIM_INFINITY:
+            hard = 1 << 20
+        if soft != resource.RLIM_INFINITY and soft < hard:
+            resource.setrlimit(resource.RLIMIT_NOFILE, (hard, hard))
+    except (ImportError, ValueError, OSError):
+        pass
+    finder = bcast_finder(mpi, directory)
+    sys.meta_path.insert(0, finder)
+    return finder
+
+#the code of the module spec describes on rank 0, with whether it came
+#from an up to date .pyc
+def read_code(spec):
+    import importlib.machinery, importlib.util
+    f = open(spec.origin, 'rb')
+    data = f.read()
+    f.close()
+    if isinstance(spec.loader, importlib.machinery.SourcelessFileLoader):
+        return data[16:], True
+    st = os.stat(spec.origin)
+    try:
+        f = open(importlib.util.cache_from_source(spec.origin), 'rb')
+        pyc = f.read()
+        f.close()
+        flags, mtime, size = struct.unpack('<III', pyc[4:16])
+        if pyc[:4] == importlib.util.MAGIC_NUMBER and flags == 0 and mtime == int(st.st_mtime) & 0xFFFFFFFF and size == st.st_size & 0xFFFFFFFF:
+            return pyc[16:], True
+    except (IOError, OSError, struct.error):
+        pass
+    return marshal.dumps(compile(data, spec.origin, 'exec', dont_inherit=True)), False
+
+class source_finder:
+    def __init__(self, mpi):
+        self.mpi = mpi
+        self.prefixes = source_prefixes + [p for p in os.environ.get('PYNAMIC_BCAST_MODULES', '').split(',') if p != '']
+        #the code objects by module name and mtime
+        self.cache = {}
+        self.modules = 0
+        self.bytecode = 0
+        self.cache_hits = 0
+        self.bytes = 0
+        self.bcast_time = 0.0
+        self.load_time = 0.0
+        self.install_time = time.time()
+
+    #rank 0 finds the module and broadcasts (origin, mtime, package
+    #locations, marshalled code), with no code if every rank has it cached
+    def receive(self, name, path):
+        import importlib.machinery
+        start = time.time()
+        message = None
+        if self.mpi.rank == 0:
+            spec = importlib.machinery.PathFinder.find_spec(name, path)
+            if spec != None and isinstance(spec.loader, (importlib.machinery.SourceFileLoader, importlib.machinery.SourcelessFileLoader)):
+                mtime = os.stat(spec.origin).st_mtime
+                message = (spec.origin, mtime, spec.submodule_search_locations, None, False)
+                if (name, mtime) not in self.cache:
+                    data, from_bytecode = read_code(spec)
+                    message = (spec.origin, mtime, spec.submodule_search_locations, data, from_bytecode)
+        message = self.mpi.bcast(message, 0)
+        self.bcast_time += time.time() - start
+        return message
+
+    def find_spec(self, name, path, target=None):
+        if len([p for p in self.prefixes if name.split('.')[0].startswith(p)]) == 0:
+            return None
+        message = self.receive(name, path)
+        if message == None:
+            return None
+        origin, mtime, locations, data, from_bytecode = message
+        start = time.time()
+        if data == None:
+            self.cache_hits += 1
+        else:
+            self.cache[(name, mtime)] = marshal.loads(data)
+            self.bytes += len(data)
+            if from_bytecode:
+                self.bytecode += 1
+        self.modules += 1
+        self.load_time += time.time() - start
+        import importlib.machinery
+        spec = importlib.machinery.ModuleSpec(name, source_loader(self.cache[(name, mtime)]), origin=origin, is_package=locations != None)
+        if locations != None:
+            spec.submodule_search_locations = list(locations)
+        spec.has_location = True
+        return spec
+
+class source_loader:
+    def __init__(self, code):
+        self.code = code
+
+    def create_module(self, spec):
+        return None
+
+    def exec_module(self, module):
+        exec(self.code, module.__dict__)
+
+#the broadcast of the launcher, which has no MPI wrapper of the driver yet
+class mpi4py_comm:
+    def __init__(self):
+        from mpi4py import MPI
+        self.comm = MPI.COMM_WORLD
+        self.rank = self.comm.Get_rank()
+
+    def bcast(self, obj, root):
+        return self.comm.bcast(obj, root=root)
+
+#install the source hook before the path based import, once per process
+def install_source(mpi=None):
+    if sys.version_info[0] < 3:
+        return None
+    for finder in sys.meta_path:
+        if isinstance(finder, source_finder):
+            return finder
+    if mpi == None:
+        mpi = mpi4py_comm()
+    import importlib.machinery
+    finder = source_finder(mpi)
+    index = len(sys.meta_path)
+    if importlib.machinery.PathFinder in sys.meta_path:
+        index = sys.meta_path.index(importlib.machinery.PathFinder)
+    sys.meta_path.insert(index, finder)
+    return finder
+
+#
+#COPYRIGHT
+#
+#Copyright (c) 2007, The Regents of the University of California.
+#Produced at the Lawrence Livermore National Laboratory
+#Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+#UCRL-CODE-228991.
+#All rights reserved.
+#
+#This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+#
+#Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+#
+#* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+#* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+#* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+#
+#THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,285 @@
+/*
+ * Please see COPYRIGHT information at the end of this file
+ * File: pynamic_dlopen.c
+ *
+ * Times the dynamic loader on the generated libraries without Python.  The
+ * driver's import and visit times include creating the module objects and
+ * calling through the interpreter; this harness only dlopens the libraries,
+ * looks up their functions and calls the C entry function of every module,
+ * so a change in the startup time can be attributed to ld.so or to Python.
+ *
+ *     pynamic_dlopen [-m <manifest>] [-l] [-g] [-o <csv_file>]
+ *
+ * reads the manifest so_generator.py writes (default pynamic_dlopen.manifest),
+ * one line per item in the order the libraries were generated:
+ *
+ *     scope global       open every library RTLD_GLOBAL, as -g does
+ *     preload <path>     a library loaded RTLD_GLOBAL first, libpython
+ *     library <path>     a library to dlopen
+ *     symbol <name>      a function of the last library to dlsym
+ *     entry <name>       an int (void) function of the last library to call
+ *
+ * Every library is opened first, then every symbol is looked up and then
+ * every entry function is called, as the driver imports all modules before
+ * it visits them.  The libraries are opened RTLD_NOW | RTLD_LOCAL like
+ * Python opens extension modules; -l uses RTLD_LAZY and -g RTLD_GLOBAL.
+ * Modules generated with -e but no --topology call each other without
+ * DT_NEEDED entries, so their manifest asks for RTLD_GLOBAL.
+ * -o writes the time of every stage of every library to <csv_file>.
+ */
+
+#define _GNU_SOURCE
+#include <dlfcn.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+struct library {
+	char *path;
+	int preload;
+	void *handle;
+	char **symbols;
+	int num_symbols;
+	int max_symbols;
+	char *entry;
+	int missing;
+	long long dlopen_ns;
+	long long dlsym_ns;
+	long long call_ns;
+};
+
+static struct library *libraries = NULL;
+static int num_libraries = 0;
+
+static long long now_ns()
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void *allocate(void *p, size_t size)
+{
+	p = realloc(p, size);
+	if (p == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+	return p;
+}
+
+static struct library *add_library(const char *path, int preload)
+{
+	static int max_libraries = 0;
+	struct library *library;
+
+	if (num_libraries == max_libraries) {
+		max_libraries = max_libraries == 0 ? 256 : max_libraries * 2;
+		libraries = allocate(libraries, max_libraries * sizeof(struct library));
+	}
+	library = &libraries[num_libraries++];
+	memset(library, 0, sizeof(struct library));
+	library->path = strdup(path);
+	library->preload = preload;
+	return library;
+}
+
+static void read_manifest(const char *filename, int *scope)
+{
+	char line[8192], keyword[64], name[8192];
+	struct library *library = NULL;
+	FILE *f = fopen(filename, "r");
+	int line_num = 0;
+
+	if (f == NULL) {
+		perror(filename);
+		exit(EXIT_FAILURE);
+	}
+	while (fgets(line, sizeof(line), f) != NULL) {
+		line_num++;
+		if (line[0] == '#' || sscanf(line, "%63s %8191s", keyword, name) != 2)
+			continue;
+		if (strcmp(keyword, "scope") == 0)
+			*scope = strcmp(name, "global") == 0 ? RTLD_GLOBAL : RTLD_LOCAL;
+		else if (strcmp(keyword, "preload") == 0 || strcmp(keyword, "library") == 0)
+			library = add_library(name, keyword[0] == 'p');
+		else if (library == NULL)
+			fprintf(stderr, "%s:%d: %s before the first library\n", filename, line_num, keyword);
+		else if (strcmp(keyword, "symbol") == 0) {
+			if (library->num_symbols == library->max_symbols) {
+				library->max_symbols = library->max_symbols == 0 ? 16 : library->max_symbols * 2;
+				library->symbols = allocate(library->symbols, library->max_symbols * sizeof(char *));
+			}
+			library->symbols[library->num_symbols++] = strdup(name);
+		} else if (strcmp(keyword, "entry") == 0)
+			library->entry = strdup(name);
+		else
+			fprintf(stderr, "%s:%d: unknown keyword %s\n", filename, line_num, keyword);
+	}
+	fclose(f);
+}
+
+/* the slowest generated library of a stage, or NULL if none took time */
+static const struct library *slowest(size_t offset)
+{
+	const struct library *max = NULL;
+	int i;
+
+	for (i = 0; i < num_libraries; i++) {
+		long long ns = *(const long long *) ((const char *) &libraries[i] + offset);
+		if (!libraries[i].preload && ns > 0 && (max == NULL || ns > *(const long long *) ((const char *) max + offset)))
+			max = &libraries[i];
+	}
+	return max;
+}
+
+static void print_stage(const char *stage, size_t offset, const char *details)
+{
+	const struct library *max = slowest(offset);
+	long long total = 0;
+	int i;
+
+	for (i = 0; i < num_libraries; i++)
+		if (!libraries[i].preload)
+			total += *(const long long *) ((const char *) &libraries[i] + offset);
+	printf("Pynamic: %s time = %.6f secs%s\n", stage, total / 1e9, details);
+	if (max != NULL)
+		printf("Pynamic: slowest %s = %.6f secs (%s)\n", stage,
+		       *(const long long *) ((const char *) max + offset) / 1e9, max->path);
+}
+
+static void write_csv(const char *filename)
+{
+	FILE *f = fopen(filename, "w");
+	int i;
+
+	if (f == NULL) {
+		perror(filename);
+		return;
+	}
+	fprintf(f, "library,preload,dlopen_ns,symbols,missing,dlsym_ns,call_ns\n");
+	for (i = 0; i < num_libraries; i++)
+		fprintf(f, "%s,%d,%lld,%d,%d,%lld,%lld\n", libraries[i].path, libraries[i].preload,
+			libraries[i].dlopen_ns, libraries[i].num_symbols, libraries[i].missing,
+			libraries[i].dlsym_ns, libraries[i].call_ns);
+	fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *manifest = "pynamic_dlopen.manifest", *csv_file = NULL;
+	int binding = RTLD_NOW, scope = RTLD_LOCAL, force_global = 0;
+	int opt, i, j, failures = 0, num_symbols = 0, missing = 0, num_entries = 0, bad_usage = 0;
+	long long preload_ns = 0, start_ns;
+	char details[256];
+	volatile int ret_val = 0;
+
+	while (!bad_usage && (opt = getopt(argc, argv, "m:lgo:")) != -1) {
+		if (opt == 'm')
+			manifest = optarg;
+		else if (opt == 'l')
+			binding = RTLD_LAZY;
+		else if (opt == 'g')
+			force_global = 1;
+		else if (opt == 'o')
+			csv_file = optarg;
+		else
+			bad_usage = 1;
+	}
+	if (bad_usage || optind != argc) {
+		printf("Usage: pynamic_dlopen [-m manifest] [-l] [-g] [-o csv_file]\n");
+		return EXIT_FAILURE;
+	}
+	read_manifest(manifest, &scope);
+	if (force_global)
+		scope = RTLD_GLOBAL;
+
+	start_ns = now_ns();
+	for (i = 0; i < num_libraries; i++) {
+		struct library *library = &libraries[i];
+		long long ns = now_ns();
+
+		library->handle = dlopen(library->path, binding | (library->preload ? RTLD_GLOBAL : scope));
+		library->dlopen_ns = now_ns() - ns;
+		if (library->handle == NULL) {
+			fprintf(stderr, "%s\n", dlerror());
+			failures++;
+		}
+		if (library->preload)
+			preload_ns += library->dlopen_ns;
+	}
+	for (i = 0; i < num_libraries; i++) {
+		struct library *library = &libraries[i];
+		long long ns = now_ns();
+
+		if (library->handle == NULL)
+			continue;
+		/* with -fvisibility=hidden or a version script only some of
+		 * the functions are exported, any other miss is a manifest
+		 * that does not match the library */
+		for (j = 0; j < library->num_symbols; j++)
+			if (dlsym(library->handle, library->symbols[j]) == NULL)
+				library->missing++;
+		library->dlsym_ns = now_ns() - ns;
+		num_symbols += library->num_symbols;
+		missing += library->missing;
+	}
+	for (i = 0; i < num_libraries; i++) {
+		struct library *library = &libraries[i];
+		int (*entry)(void);
+		long long ns = now_ns();
+
+		if (library->handle == NULL || library->entry == NULL)
+			continue;
+		/* the lookup of the entry function is timed with its call */
+		*(void **) &entry = dlsym(library->handle, library->entry);
+		if (entry == NULL) {
+			fprintf(stderr, "%s: %s not found\n", library->path, library->entry);
+			failures++;
+			continue;
+		}
+		ret_val += entry();
+		library->call_ns = now_ns() - ns;
+		num_entries++;
+	}
+
+	printf("Pynamic: dlopen harness, %d libraries from %s, %s | %s\n", num_libraries, manifest,
+	       binding == RTLD_NOW ? "RTLD_NOW" : "RTLD_LAZY", scope == RTLD_GLOBAL ? "RTLD_GLOBAL" : "RTLD_LOCAL");
+	if (preload_ns > 0)
+		printf("Pynamic: preload time = %.6f secs\n", preload_ns / 1e9);
+	print_stage("dlopen", offsetof(struct library, dlopen_ns), "");
+	snprintf(details, sizeof(details), " (%d symbols, %d not found)", num_symbols, missing);
+	print_stage("dlsym", offsetof(struct library, dlsym_ns), details);
+	snprintf(details, sizeof(details), " (%d entry functions)", num_entries);
+	print_stage("call", offsetof(struct library, call_ns), details);
+	printf("Pynamic: total time = %.6f secs\n", (now_ns() - start_ns) / 1e9);
+	if (failures > 0)
+		printf("Pynamic: %d libraries or entry functions failed to load\n", failures);
+	if (csv_file != NULL)
+		write_csv(csv_file);
+	return failures > 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
+
+/*************************************************
+COPYRIGHT
+
+Copyright (c) 2007, The Regents of the University of California.
+Produced at the Lawrence Livermore National Laboratory
+Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+UCRL-CODE-228991.
+All rights reserved.
+
+This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************/
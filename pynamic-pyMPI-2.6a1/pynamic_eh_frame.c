@@ -0,0 +1,64 @@
+/*
+ * Please see COPYRIGHT information at the end of this file
+ * File: pynamic_eh_frame.c
+ *
+ * Registers the unwind tables of a module linked with --no-eh-frame-hdr.
+ * Without the .eh_frame_hdr section and its PT_GNU_EH_FRAME segment the
+ * unwinder cannot find the frame descriptions of the library through
+ * dl_iterate_phdr, so an exception thrown through it terminates the
+ * program.  Linked in front of a module's object, the empty array below
+ * lands at the start of the module's .eh_frame, and the constructor
+ * registers the tables from there to the terminator crtendS.o adds with
+ * __register_frame_info, as crtbegin did before .eh_frame_hdr existed.
+ * The linker puts the unwind info it generates for the PLT in front of
+ * every input section, so the module is also linked with
+ * --no-ld-generated-unwind-info; no exception passes through a PLT stub.
+ * The unwinder then searches the registered objects before it asks the
+ * loader, which is the cost --no-eh-frame-hdr measures.
+ *
+ * It must be compiled without unwind tables of its own, or they would
+ * precede the array:
+ *
+ *     cc -fPIC -fno-asynchronous-unwind-tables -fno-exceptions -c pynamic_eh_frame.c
+ */
+
+/* the object the unwinder keeps for the registered tables, larger than its
+ * struct object in libgcc */
+static struct {
+	void *fields[8];
+} eh_object;
+
+static const char __attribute__((section(".eh_frame"), aligned(4), used)) eh_frame_begin[0] = {};
+
+extern void __register_frame_info(const void *begin, void *object);
+extern void *__deregister_frame_info(const void *begin);
+
+static void __attribute__((constructor)) register_eh_frame(void)
+{
+	__register_frame_info(eh_frame_begin, &eh_object);
+}
+
+static void __attribute__((destructor)) deregister_eh_frame(void)
+{
+	__deregister_frame_info(eh_frame_begin);
+}
+
+/*************************************************
+COPYRIGHT
+
+Copyright (c) 2007, The Regents of the University of California.
+Produced at the Lawrence Livermore National Laboratory
+Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+UCRL-CODE-228991.
+All rights reserved.
+
+This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************/
@@ -0,0 +1,902 @@
+/*
+ * Please see COPYRIGHT information at the end of this file
+ * File: pynamic_elfstats.c
+ *
+ * Reports the same sizes as the get-symtab-sizes pipeline for an
+ * executable and every library in its ldd closure, without running
+ * size, readelf and gawk for each library.  Every file is mapped once and
+ * its section headers are read directly, with the files spread over
+ * several threads.
+ *
+ *     pynamic_elfstats [-j <num_threads>] [-o <json_file>] <executable>
+ *
+ * prints the per file sizes and the summary of get-symtab-sizes and, with
+ * -o, writes the same numbers to <json_file>.
+ *
+ * It also reports what the dynamic loader has to do for each file: the
+ * PT_LOAD segments it maps, the dynamic relocations it applies by type,
+ * the PLT entries and .dynsym entries, the bucket occupancy and chain
+ * lengths of the GNU hash table every symbol lookup walks, the DT_NEEDED
+ * entries and the depth of each library in the breadth first order the
+ * loader follows from the executable.
+ */
+
+#define _GNU_SOURCE
+#include <elf.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifndef SHT_RELR
+#define SHT_RELR 19
+#endif
+
+/* the classes of dynamic relocations, the same for every machine */
+enum reloc_class {
+	RELOC_RELATIVE,
+	RELOC_SYMBOLIC,
+	RELOC_GLOB_DAT,
+	RELOC_JUMP_SLOT,
+	RELOC_TLS,
+	RELOC_COPY,
+	RELOC_IRELATIVE,
+	RELOC_OTHER,
+	NUM_RELOC_CLASSES
+};
+
+static const char *reloc_class_names[NUM_RELOC_CLASSES] = {
+	"relative", "symbolic", "glob_dat", "jump_slot", "tls", "copy", "irelative", "other"
+};
+
+static const struct {
+	int machine;
+	unsigned int type;
+	enum reloc_class class;
+} reloc_types[] = {
+	{EM_X86_64, R_X86_64_RELATIVE, RELOC_RELATIVE},
+	{EM_X86_64, R_X86_64_64, RELOC_SYMBOLIC},
+	{EM_X86_64, R_X86_64_GLOB_DAT, RELOC_GLOB_DAT},
+	{EM_X86_64, R_X86_64_JUMP_SLOT, RELOC_JUMP_SLOT},
+	{EM_X86_64, R_X86_64_DTPMOD64, RELOC_TLS},
+	{EM_X86_64, R_X86_64_DTPOFF64, RELOC_TLS},
+	{EM_X86_64, R_X86_64_TPOFF64, RELOC_TLS},
+	{EM_X86_64, R_X86_64_TLSDESC, RELOC_TLS},
+	{EM_X86_64, R_X86_64_COPY, RELOC_COPY},
+	{EM_X86_64, R_X86_64_IRELATIVE, RELOC_IRELATIVE},
+	{EM_386, R_386_RELATIVE, RELOC_RELATIVE},
+	{EM_386, R_386_32, RELOC_SYMBOLIC},
+	{EM_386, R_386_GLOB_DAT, RELOC_GLOB_DAT},
+	{EM_386, R_386_JMP_SLOT, RELOC_JUMP_SLOT},
+	{EM_386, R_386_TLS_DTPMOD32, RELOC_TLS},
+	{EM_386, R_386_TLS_DTPOFF32, RELOC_TLS},
+	{EM_386, R_386_TLS_TPOFF, RELOC_TLS},
+	{EM_386, R_386_TLS_TPOFF32, RELOC_TLS},
+	{EM_386, R_386_TLS_DESC, RELOC_TLS},
+	{EM_386, R_386_COPY, RELOC_COPY},
+	{EM_386, R_386_IRELATIVE, RELOC_IRELATIVE},
+	{EM_AARCH64, R_AARCH64_RELATIVE, RELOC_RELATIVE},
+	{EM_AARCH64, R_AARCH64_ABS64, RELOC_SYMBOLIC},
+	{EM_AARCH64, R_AARCH64_GLOB_DAT, RELOC_GLOB_DAT},
+	{EM_AARCH64, R_AARCH64_JUMP_SLOT, RELOC_JUMP_SLOT},
+	{EM_AARCH64, R_AARCH64_TLS_DTPMOD, RELOC_TLS},
+	{EM_AARCH64, R_AARCH64_TLS_DTPREL, RELOC_TLS},
+	{EM_AARCH64, R_AARCH64_TLS_TPREL, RELOC_TLS},
+	{EM_AARCH64, R_AARCH64_TLSDESC, RELOC_TLS},
+	{EM_AARCH64, R_AARCH64_COPY, RELOC_COPY},
+	{EM_AARCH64, R_AARCH64_IRELATIVE, RELOC_IRELATIVE},
+	{EM_PPC64, R_PPC64_RELATIVE, RELOC_RELATIVE},
+	{EM_PPC64, R_PPC64_ADDR64, RELOC_SYMBOLIC},
+	{EM_PPC64, R_PPC64_GLOB_DAT, RELOC_GLOB_DAT},
+	{EM_PPC64, R_PPC64_JMP_SLOT, RELOC_JUMP_SLOT},
+	{EM_PPC64, R_PPC64_DTPMOD64, RELOC_TLS},
+	{EM_PPC64, R_PPC64_DTPREL64, RELOC_TLS},
+	{EM_PPC64, R_PPC64_TPREL64, RELOC_TLS},
+	{EM_PPC64, R_PPC64_COPY, RELOC_COPY},
+	{EM_PPC64, R_PPC64_IRELATIVE, RELOC_IRELATIVE},
+	{EM_NONE, 0, RELOC_OTHER}
+};
+
+/* GNU hash chains of 0 to HASH_CHAIN_MAX - 1 symbols, and longer ones */
+#define HASH_CHAIN_MAX 5
+
+struct loader_stats {
+	long long load_segments;
+	long long dynsyms;
+	long long dynsyms_undefined;
+	long long relocs[NUM_RELOC_CLASSES];
+	long long symbol_relocs;
+	long long plt_entries;
+	int has_gnu_hash;
+	long long hash_buckets;
+	long long hash_buckets_used;
+	long long hash_max_chain;
+	long long hash_chains[HASH_CHAIN_MAX + 1];
+	long long needed;
+};
+
+struct elf_stats {
+	char *path;
+	int is_elf;
+	long long image_size;
+	long long text_size;
+	long long data_size;
+	long long debug_size;
+	long long debug_raw_size;
+	long long dwo_size;
+	int has_dwo;
+	long long symtab_size;
+	long long strtab_size;
+	struct loader_stats loader;
+	char *soname;
+	char **needed;
+	int depth;
+};
+
+/* the fields of a section header that are the same for both ELF classes */
+struct section {
+	const char *name;
+	unsigned long long name_offset;
+	unsigned long long type;
+	unsigned long long flags;
+	unsigned long long offset;
+	unsigned long long size;
+	unsigned long long link;
+	unsigned long long entsize;
+};
+
+static struct elf_stats *files = NULL;
+static int num_files = 0;
+static int next_file = 0;
+static pthread_mutex_t next_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/* the section headers of the mapped ELF file, or NULL if it is not one */
+static struct section *read_sections(const unsigned char *data, size_t size, int *num_sections)
+{
+	unsigned long long shoff;
+	unsigned int shnum, shstrndx, shentsize, i;
+	int is_64;
+	struct section *sections;
+	const char *strings = NULL;
+	unsigned long long strings_size = 0;
+
+	if (size < EI_NIDENT || memcmp(data, ELFMAG, SELFMAG) != 0)
+		return NULL;
+	is_64 = data[EI_CLASS] == ELFCLASS64;
+	if ((!is_64 && data[EI_CLASS] != ELFCLASS32) ||
+	    size < (is_64 ? sizeof(Elf64_Ehdr) : sizeof(Elf32_Ehdr)))
+		return NULL;
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+	if (data[EI_DATA] != ELFDATA2LSB)
+		return NULL;
+#else
+	if (data[EI_DATA] != ELFDATA2MSB)
+		return NULL;
+#endif
+	if (is_64) {
+		const Elf64_Ehdr *ehdr = (const Elf64_Ehdr *) data;
+		shoff = ehdr->e_shoff;
+		shnum = ehdr->e_shnum;
+		shstrndx = ehdr->e_shstrndx;
+		shentsize = sizeof(Elf64_Shdr);
+	} else {
+		const Elf32_Ehdr *ehdr = (const Elf32_Ehdr *) data;
+		shoff = ehdr->e_shoff;
+		shnum = ehdr->e_shnum;
+		shstrndx = ehdr->e_shstrndx;
+		shentsize = sizeof(Elf32_Shdr);
+	}
+	if (shoff == 0 || shoff + shentsize > size)
+		return NULL;
+	/* with many sections the real counts are in section 0 */
+	if (shnum == 0)
+		shnum = is_64 ? ((const Elf64_Shdr *) (data + shoff))->sh_size : ((const Elf32_Shdr *) (data + shoff))->sh_size;
+	if (shstrndx == SHN_XINDEX)
+		shstrndx = is_64 ? ((const Elf64_Shdr *) (data + shoff))->sh_link : ((const Elf32_Shdr *) (data + shoff))->sh_link;
+	if (shoff + (unsigned long long) shnum * shentsize > size)
+		return NULL;
+
+	sections = calloc(shnum + 1, sizeof(struct section));
+	if (sections == NULL)
+		return NULL;
+	for (i = 0; i < shnum; i++) {
+		if (is_64) {
+			const Elf64_Shdr *shdr = (const Elf64_Shdr *) (data + shoff) + i;
+			sections[i].type = shdr->sh_type;
+			sections[i].flags = shdr->sh_flags;
+			sections[i].offset = shdr->sh_offset;
+			sections[i].size = shdr->sh_size;
+			sections[i].link = shdr->sh_link;
+			sections[i].entsize = shdr->sh_entsize;
+			sections[i].name_offset = shdr->sh_name;
+		} else {
+			const Elf32_Shdr *shdr = (const Elf32_Shdr *) (data + shoff) + i;
+			sections[i].type = shdr->sh_type;
+			sections[i].flags = shdr->sh_flags;
+			sections[i].offset = shdr->sh_offset;
+			sections[i].size = shdr->sh_size;
+			sections[i].link = shdr->sh_link;
+			sections[i].entsize = shdr->sh_entsize;
+			sections[i].name_offset = shdr->sh_name;
+		}
+	}
+	if (shstrndx < shnum && sections[shstrndx].offset + sections[shstrndx].size <= size) {
+		strings = (const char *) data + sections[shstrndx].offset;
+		strings_size = sections[shstrndx].size;
+	}
+	for (i = 0; i < shnum; i++) {
+		unsigned long long name = sections[i].name_offset;
+		if (strings != NULL && name < strings_size && memchr(strings + name, '\0', strings_size - name) != NULL)
+			sections[i].name = strings + name;
+		else
+			sections[i].name = "";
+	}
+	*num_sections = shnum;
+	return sections;
+}
+
+/* the uncompressed size of a SHF_COMPRESSED section */
+static unsigned long long uncompressed_size(const unsigned char *data, size_t size, const struct section *section)
+{
+	if (data[EI_CLASS] == ELFCLASS64) {
+		if (section->offset + sizeof(Elf64_Chdr) <= size)
+			return ((const Elf64_Chdr *) (data + section->offset))->ch_size;
+	} else if (section->offset + sizeof(Elf32_Chdr) <= size)
+		return ((const Elf32_Chdr *) (data + section->offset))->ch_size;
+	return section->size;
+}
+
+/* the contents of a section, or NULL if they are not in the file */
+static const unsigned char *section_data(const unsigned char *data, size_t size, const struct section *section)
+{
+	if (section->type == SHT_NOBITS || section->offset > size || section->size > size - section->offset)
+		return NULL;
+	return data + section->offset;
+}
+
+static enum reloc_class classify_reloc(int machine, unsigned int type)
+{
+	int i;
+
+	for (i = 0; reloc_types[i].machine != EM_NONE; i++)
+		if (reloc_types[i].machine == machine && reloc_types[i].type == type)
+			return reloc_types[i].class;
+	return RELOC_OTHER;
+}
+
+static void count_segments(const unsigned char *data, size_t size, struct loader_stats *loader)
+{
+	unsigned long long phoff;
+	unsigned int phnum, phentsize, i;
+	int is_64 = data[EI_CLASS] == ELFCLASS64;
+
+	if (is_64) {
+		phoff = ((const Elf64_Ehdr *) data)->e_phoff;
+		phnum = ((const Elf64_Ehdr *) data)->e_phnum;
+		phentsize = sizeof(Elf64_Phdr);
+	} else {
+		phoff = ((const Elf32_Ehdr *) data)->e_phoff;
+		phnum = ((const Elf32_Ehdr *) data)->e_phnum;
+		phentsize = sizeof(Elf32_Phdr);
+	}
+	if (phoff == 0 || phoff > size || (unsigned long long) phnum * phentsize > size - phoff)
+		return;
+	for (i = 0; i < phnum; i++) {
+		unsigned int type = is_64 ? ((const Elf64_Phdr *) (data + phoff))[i].p_type :
+					    ((const Elf32_Phdr *) (data + phoff))[i].p_type;
+		if (type == PT_LOAD)
+			loader->load_segments++;
+	}
+}
+
+/* the relocations the loader applies when it maps the file */
+static void count_relocs(const unsigned char *data, size_t size, const struct section *section,
+			 struct loader_stats *loader)
+{
+	const unsigned char *relocs = section_data(data, size, section);
+	int is_64 = data[EI_CLASS] == ELFCLASS64;
+	int machine = ((const Elf32_Ehdr *) data)->e_machine;
+	unsigned long long entsize, num_relocs, i;
+	size_t len = strlen(section->name);
+	int is_plt = len >= 4 && strcmp(section->name + len - 4, ".plt") == 0;
+
+	if (relocs == NULL)
+		return;
+	if (section->type == SHT_RELR) {
+		/* an even word is one relative relocation, an odd one a
+		 * bitmap of the next ones with the low bit as the marker */
+		entsize = is_64 ? 8 : 4;
+		for (i = 0; i + entsize <= section->size; i += entsize) {
+			unsigned long long word = is_64 ? *(const Elf64_Addr *) (relocs + i) :
+							  *(const Elf32_Addr *) (relocs + i);
+			loader->relocs[RELOC_RELATIVE] += (word & 1) ? __builtin_popcountll(word) - 1 : 1;
+		}
+		return;
+	}
+
+	if (section->type == SHT_RELA)
+		entsize = is_64 ? sizeof(Elf64_Rela) : sizeof(Elf32_Rela);
+	else
+		entsize = is_64 ? sizeof(Elf64_Rel) : sizeof(Elf32_Rel);
+	if (section->entsize >= entsize)
+		entsize = section->entsize;
+	num_relocs = section->size / entsize;
+	for (i = 0; i < num_relocs; i++) {
+		/* r_info follows r_offset in both Rel and Rela */
+		unsigned long long type, sym;
+
+		if (is_64) {
+			Elf64_Xword info = ((const Elf64_Rel *) (relocs + i * entsize))->r_info;
+			type = ELF64_R_TYPE(info);
+			sym = ELF64_R_SYM(info);
+		} else {
+			Elf32_Word info = ((const Elf32_Rel *) (relocs + i * entsize))->r_info;
+			type = ELF32_R_TYPE(info);
+			sym = ELF32_R_SYM(info);
+		}
+		loader->relocs[classify_reloc(machine, type)]++;
+		if (sym != 0)
+			loader->symbol_relocs++;
+	}
+	if (is_plt)
+		loader->plt_entries += num_relocs;
+}
+
+static void count_dynsyms(const unsigned char *data, size_t size, const struct section *section,
+			  struct loader_stats *loader)
+{
+	const unsigned char *syms = section_data(data, size, section);
+	int is_64 = data[EI_CLASS] == ELFCLASS64;
+	unsigned long long entsize = is_64 ? sizeof(Elf64_Sym) : sizeof(Elf32_Sym);
+	unsigned long long num_syms, i;
+
+	if (syms == NULL)
+		return;
+	if (section->entsize >= entsize)
+		entsize = section->entsize;
+	num_syms = section->size / entsize;
+	loader->dynsyms += num_syms;
+	/* entry 0 is the undefined symbol every table starts with */
+	for (i = 1; i < num_syms; i++) {
+		unsigned int shndx = is_64 ? ((const Elf64_Sym *) (syms + i * entsize))->st_shndx :
+					     ((const Elf32_Sym *) (syms + i * entsize))->st_shndx;
+		if (shndx == SHN_UNDEF)
+			loader->dynsyms_undefined++;
+	}
+}
+
+/* the buckets and chains of the .gnu.hash table a symbol lookup walks */
+static void count_gnu_hash(const unsigned char *data, size_t size, const struct section *section,
+			   struct loader_stats *loader)
+{
+	const unsigned char *hash = section_data(data, size, section);
+	unsigned long long word_size = data[EI_CLASS] == ELFCLASS64 ? 8 : 4;
+	unsigned long long num_buckets, sym_offset, bloom_size, num_chains, bucket, length;
+	const Elf32_Word *buckets, *chains;
+
+	if (hash == NULL || section->size < 16)
+		return;
+	num_buckets = ((const Elf32_Word *) hash)[0];
+	sym_offset = ((const Elf32_Word *) hash)[1];
+	bloom_size = ((const Elf32_Word *) hash)[2];
+	if (16 + bloom_size * word_size + num_buckets * 4 > section->size)
+		return;
+	buckets = (const Elf32_Word *) (hash + 16 + bloom_size * word_size);
+	chains = buckets + num_buckets;
+	num_chains = (section->size - 16 - bloom_size * word_size - num_buckets * 4) / 4;
+
+	loader->has_gnu_hash = 1;
+	loader->hash_buckets += num_buckets;
+	for (bucket = 0; bucket < num_buckets; bucket++) {
+		unsigned long long sym = buckets[bucket];
+
+		length = 0;
+		if (sym >= sym_offset) {
+			/* the last symbol of a chain has the low bit set */
+			while (sym - sym_offset < num_chains) {
+				length++;
+				if (chains[sym - sym_offset] & 1)
+					break;
+				sym++;
+			}
+		}
+		if (length > 0)
+			loader->hash_buckets_used++;
+		if (length > loader->hash_max_chain)
+			loader->hash_max_chain = length;
+		loader->hash_chains[length < HASH_CHAIN_MAX ? length : HASH_CHAIN_MAX]++;
+	}
+}
+
+/* the DT_NEEDED entries and DT_SONAME of the .dynamic section */
+static void read_dynamic(const unsigned char *data, size_t size, const struct section *sections,
+			 int num_sections, const struct section *section, struct elf_stats *stats)
+{
+	const unsigned char *dynamic = section_data(data, size, section);
+	const unsigned char *strings;
+	int is_64 = data[EI_CLASS] == ELFCLASS64;
+	unsigned long long entsize = is_64 ? sizeof(Elf64_Dyn) : sizeof(Elf32_Dyn);
+	unsigned long long num_entries, strings_size, i;
+	int num_needed = 0;
+
+	if (dynamic == NULL || section->link >= (unsigned long long) num_sections)
+		return;
+	strings = section_data(data, size, &sections[section->link]);
+	strings_size = sections[section->link].size;
+	if (strings == NULL)
+		return;
+	num_entries = section->size / entsize;
+	stats->needed = calloc(num_entries + 1, sizeof(char *));
+	if (stats->needed == NULL)
+		return;
+	for (i = 0; i < num_entries; i++) {
+		long long tag;
+		unsigned long long value;
+		const char *name;
+
+		if (is_64) {
+			tag = ((const Elf64_Dyn *) dynamic)[i].d_tag;
+			value = ((const Elf64_Dyn *) dynamic)[i].d_un.d_val;
+		} else {
+			tag = ((const Elf32_Dyn *) dynamic)[i].d_tag;
+			value = ((const Elf32_Dyn *) dynamic)[i].d_un.d_val;
+		}
+		if (tag == DT_NULL)
+			break;
+		if ((tag != DT_NEEDED && tag != DT_SONAME) || value >= strings_size ||
+		    memchr(strings + value, '\0', strings_size - value) == NULL)
+			continue;
+		name = (const char *) strings + value;
+		if (tag == DT_SONAME)
+			stats->soname = strdup(name);
+		else
+			stats->needed[num_needed++] = strdup(name);
+	}
+	stats->loader.needed = num_needed;
+}
+
+static void scan_file(struct elf_stats *stats)
+{
+	struct stat st;
+	unsigned char *data;
+	struct section *sections;
+	char *dwo;
+	size_t len;
+	int fd, num_sections, i;
+
+	fd = open(stats->path, O_RDONLY);
+	if (fd < 0)
+		return;
+	if (fstat(fd, &st) != 0) {
+		close(fd);
+		return;
+	}
+	stats->image_size = st.st_size;
+	data = st.st_size > 0 ? mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+	close(fd);
+	if (data == MAP_FAILED)
+		return;
+
+	sections = read_sections(data, st.st_size, &num_sections);
+	if (sections != NULL) {
+		stats->is_elf = 1;
+		for (i = 0; i < num_sections; i++) {
+			const struct section *section = &sections[i];
+
+			/* the Berkeley format of size(1): code and read-only
+			 * data is text, other allocated contents data */
+			if ((section->flags & SHF_ALLOC) && section->type != SHT_NOBITS) {
+				if ((section->flags & SHF_WRITE) && !(section->flags & SHF_EXECINSTR))
+					stats->data_size += section->size;
+				else
+					stats->text_size += section->size;
+			}
+			if (strncmp(section->name, ".debug", 6) == 0) {
+				stats->debug_size += section->size;
+				if (section->flags & SHF_COMPRESSED)
+					stats->debug_raw_size += uncompressed_size(data, st.st_size, section);
+				else
+					stats->debug_raw_size += section->size;
+			} else if (strcmp(section->name, ".symtab") == 0)
+				stats->symtab_size += section->size;
+			else if (strcmp(section->name, ".strtab") == 0)
+				stats->strtab_size += section->size;
+
+			if ((section->type == SHT_RELA || section->type == SHT_REL || section->type == SHT_RELR) &&
+			    (section->flags & SHF_ALLOC))
+				count_relocs(data, st.st_size, section, &stats->loader);
+			else if (section->type == SHT_DYNSYM)
+				count_dynsyms(data, st.st_size, section, &stats->loader);
+			else if (section->type == SHT_GNU_HASH)
+				count_gnu_hash(data, st.st_size, section, &stats->loader);
+			else if (section->type == SHT_DYNAMIC && stats->needed == NULL)
+				read_dynamic(data, st.st_size, sections, num_sections, section, stats);
+		}
+		count_segments(data, st.st_size, &stats->loader);
+		free(sections);
+	}
+	munmap(data, st.st_size);
+
+	/* the .dwo file of a library built with -gsplit-dwarf */
+	len = strlen(stats->path);
+	if (len > 3 && strcmp(stats->path + len - 3, ".so") == 0) {
+		dwo = strdup(stats->path);
+		if (dwo != NULL) {
+			strcpy(dwo + len - 3, ".dwo");
+			if (stat(dwo, &st) == 0) {
+				stats->has_dwo = 1;
+				stats->dwo_size = st.st_size;
+			}
+			free(dwo);
+		}
+	}
+}
+
+static void *scan_files(void *arg)
+{
+	int i;
+
+	for (;;) {
+		pthread_mutex_lock(&next_lock);
+		i = next_file++;
+		pthread_mutex_unlock(&next_lock);
+		if (i >= num_files)
+			break;
+		scan_file(&files[i]);
+	}
+	return NULL;
+}
+
+static void add_file(const char *path)
+{
+	static int max_files = 0;
+
+	if (num_files == max_files) {
+		max_files = max_files == 0 ? 256 : max_files * 2;
+		files = realloc(files, max_files * sizeof(struct elf_stats));
+		if (files == NULL) {
+			fprintf(stderr, "out of memory\n");
+			exit(EXIT_FAILURE);
+		}
+	}
+	memset(&files[num_files], 0, sizeof(struct elf_stats));
+	files[num_files].depth = -1;
+	files[num_files++].path = strdup(path);
+}
+
+/* the executable followed by the libraries ldd resolves for it */
+static void read_closure(const char *executable)
+{
+	char *command, line[8192], path[8192];
+	FILE *ldd;
+
+	add_file(executable);
+	command = malloc(strlen(executable) + 16);
+	sprintf(command, "ldd '%s'", executable);
+	ldd = popen(command, "r");
+	free(command);
+	if (ldd == NULL)
+		return;
+	while (fgets(line, sizeof(line), ldd) != NULL) {
+		char *arrow = strstr(line, "=> ");
+
+		if (arrow != NULL && sscanf(arrow + 3, "%8191s", path) == 1 && access(path, F_OK) == 0)
+			add_file(path);
+	}
+	pclose(ldd);
+}
+
+/* the file in the closure a DT_NEEDED entry resolves to, or -1 */
+static int find_needed(const char *name)
+{
+	const char *base;
+	int i;
+
+	for (i = 0; i < num_files; i++) {
+		if (files[i].soname != NULL && strcmp(files[i].soname, name) == 0)
+			return i;
+		base = strrchr(files[i].path, '/');
+		if (strcmp(base != NULL ? base + 1 : files[i].path, name) == 0)
+			return i;
+	}
+	return -1;
+}
+
+/* the level of each file in the breadth first order the loader maps
+ * the DT_NEEDED entries in, starting with the executable at 0 */
+static void find_depths()
+{
+	int *queue, head = 0, tail = 0, i, j;
+
+	queue = malloc(num_files * sizeof(int));
+	if (queue == NULL || num_files == 0) {
+		free(queue);
+		return;
+	}
+	files[0].depth = 0;
+	queue[tail++] = 0;
+	while (head < tail) {
+		const struct elf_stats *stats = &files[queue[head++]];
+
+		for (i = 0; stats->needed != NULL && stats->needed[i] != NULL; i++) {
+			j = find_needed(stats->needed[i]);
+			if (j >= 0 && files[j].depth < 0) {
+				files[j].depth = stats->depth + 1;
+				queue[tail++] = j;
+			}
+		}
+	}
+	free(queue);
+}
+
+static void add_loader(struct loader_stats *total, const struct loader_stats *loader)
+{
+	int i;
+
+	total->load_segments += loader->load_segments;
+	total->dynsyms += loader->dynsyms;
+	total->dynsyms_undefined += loader->dynsyms_undefined;
+	for (i = 0; i < NUM_RELOC_CLASSES; i++)
+		total->relocs[i] += loader->relocs[i];
+	total->symbol_relocs += loader->symbol_relocs;
+	total->plt_entries += loader->plt_entries;
+	total->has_gnu_hash |= loader->has_gnu_hash;
+	total->hash_buckets += loader->hash_buckets;
+	total->hash_buckets_used += loader->hash_buckets_used;
+	if (loader->hash_max_chain > total->hash_max_chain)
+		total->hash_max_chain = loader->hash_max_chain;
+	for (i = 0; i <= HASH_CHAIN_MAX; i++)
+		total->hash_chains[i] += loader->hash_chains[i];
+	total->needed += loader->needed;
+}
+
+static long long num_relocs(const struct loader_stats *loader)
+{
+	long long sum = 0;
+	int i;
+
+	for (i = 0; i < NUM_RELOC_CLASSES; i++)
+		sum += loader->relocs[i];
+	return sum;
+}
+
+/* the loader metrics of one file, or of the aggregate when of names it */
+static void print_loader(const struct loader_stats *loader, const char *of)
+{
+	int i;
+
+	printf("Number of PT_LOAD segments%s: %lld\n", of, loader->load_segments);
+	printf("Number of dynamic symbols%s: %lld (%lld undefined)\n", of,
+	       loader->dynsyms, loader->dynsyms_undefined);
+	printf("Number of dynamic relocations%s: %lld (%lld with a symbol lookup)\n", of,
+	       num_relocs(loader), loader->symbol_relocs);
+	printf("Dynamic relocations%s by type:", of);
+	for (i = 0; i < NUM_RELOC_CLASSES; i++)
+		printf(" %s %lld%s", reloc_class_names[i], loader->relocs[i], i + 1 < NUM_RELOC_CLASSES ? "," : "\n");
+	printf("Number of PLT entries%s: %lld\n", of, loader->plt_entries);
+	if (loader->has_gnu_hash) {
+		printf("GNU hash buckets%s: %lld, %lld used, longest chain %lld\n", of,
+		       loader->hash_buckets, loader->hash_buckets_used, loader->hash_max_chain);
+		printf("GNU hash chain lengths%s:", of);
+		for (i = 0; i < HASH_CHAIN_MAX; i++)
+			printf(" %d: %lld,", i, loader->hash_chains[i]);
+		printf(" %d+: %lld\n", HASH_CHAIN_MAX, loader->hash_chains[HASH_CHAIN_MAX]);
+	}
+	printf("Number of DT_NEEDED entries%s: %lld\n", of, loader->needed);
+}
+
+/* the human readable format of addall -h */
+static void print_total(const char *name, long long number)
+{
+	if (number >= 1000000000)
+		printf("Size of %s: %.1fGB\n", name, number / 1000000000.0);
+	else if (number >= 1000000)
+		printf("Size of %s: %.1fMB\n", name, number / 1000000.0);
+	else if (number >= 1000)
+		printf("Size of %s: %.1fKB\n", name, number / 1000.0);
+	else
+		printf("Size of %s: %lldB\n", name, number);
+}
+
+static void json_string(FILE *f, const char *s)
+{
+	fputc('"', f);
+	for (; *s != '\0'; s++) {
+		if (*s == '"' || *s == '\\')
+			fprintf(f, "\\%c", *s);
+		else if ((unsigned char) *s < 0x20)
+			fprintf(f, "\\u%04x", *s);
+		else
+			fputc(*s, f);
+	}
+	fputc('"', f);
+}
+
+static void json_sizes(FILE *f, const struct elf_stats *stats)
+{
+	fprintf(f, "\"image\": %lld, \"text\": %lld, \"data\": %lld, \"debug\": %lld, \"debug_uncompressed\": %lld, "
+		"\"dwo\": %lld, \"symtab\": %lld, \"strtab\": %lld",
+		stats->image_size, stats->text_size, stats->data_size, stats->debug_size,
+		stats->debug_raw_size, stats->dwo_size, stats->symtab_size, stats->strtab_size);
+}
+
+static void json_loader(FILE *f, const struct loader_stats *loader)
+{
+	int i;
+
+	fprintf(f, "\"loader\": {\"pt_load\": %lld, \"dynsym\": %lld, \"dynsym_undefined\": %lld, "
+		"\"relocations\": %lld, \"symbol_relocations\": %lld, \"relocations_by_type\": {",
+		loader->load_segments, loader->dynsyms, loader->dynsyms_undefined,
+		num_relocs(loader), loader->symbol_relocs);
+	for (i = 0; i < NUM_RELOC_CLASSES; i++)
+		fprintf(f, "\"%s\": %lld%s", reloc_class_names[i], loader->relocs[i], i + 1 < NUM_RELOC_CLASSES ? ", " : "}");
+	fprintf(f, ", \"plt\": %lld, \"needed\": %lld", loader->plt_entries, loader->needed);
+	if (loader->has_gnu_hash) {
+		fprintf(f, ", \"gnu_hash\": {\"buckets\": %lld, \"used\": %lld, \"longest_chain\": %lld, \"chain_lengths\": [",
+			loader->hash_buckets, loader->hash_buckets_used, loader->hash_max_chain);
+		for (i = 0; i <= HASH_CHAIN_MAX; i++)
+			fprintf(f, "%lld%s", loader->hash_chains[i], i < HASH_CHAIN_MAX ? ", " : "]}");
+	}
+	fprintf(f, "}");
+}
+
+static void write_json(const char *filename, const char *executable, const struct elf_stats *total,
+		       long long max_needed, int max_depth)
+{
+	FILE *f = fopen(filename, "w");
+	int i, j;
+
+	if (f == NULL) {
+		perror(filename);
+		return;
+	}
+	fprintf(f, "{\n \"executable\": ");
+	json_string(f, executable);
+	fprintf(f, ",\n \"libraries\": [\n");
+	for (i = 0; i < num_files; i++) {
+		fprintf(f, "  {\"path\": ");
+		json_string(f, files[i].path);
+		fprintf(f, ", \"elf\": %s, ", files[i].is_elf ? "true" : "false");
+		json_sizes(f, &files[i]);
+		fprintf(f, ", ");
+		json_loader(f, &files[i].loader);
+		if (files[i].soname != NULL) {
+			fprintf(f, ", \"soname\": ");
+			json_string(f, files[i].soname);
+		}
+		fprintf(f, ", \"needed\": [");
+		for (j = 0; files[i].needed != NULL && files[i].needed[j] != NULL; j++) {
+			fprintf(f, "%s", j > 0 ? ", " : "");
+			json_string(f, files[i].needed[j]);
+		}
+		fprintf(f, "], \"depth\": %d", files[i].depth);
+		fprintf(f, "}%s\n", i + 1 < num_files ? "," : "");
+	}
+	fprintf(f, " ],\n \"total\": {");
+	json_sizes(f, total);
+	fprintf(f, ", ");
+	json_loader(f, &total->loader);
+	fprintf(f, ", \"max_needed\": %lld, \"max_depth\": %d}\n}\n", max_needed, max_depth);
+	fclose(f);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *json_file = NULL, *executable;
+	struct elf_stats total;
+	pthread_t *threads;
+	int num_threads = sysconf(_SC_NPROCESSORS_ONLN);
+	int opt, i, max_depth = 0, bad_usage = 0;
+	long long max_needed = 0;
+
+	while (!bad_usage && (opt = getopt(argc, argv, "j:o:")) != -1) {
+		if (opt == 'j')
+			num_threads = atoi(optarg);
+		else if (opt == 'o')
+			json_file = optarg;
+		else
+			bad_usage = 1;
+	}
+	if (bad_usage || optind != argc - 1) {
+		printf("Usage: pynamic_elfstats [-j num_threads] [-o json_file] executable\n");
+		return EXIT_FAILURE;
+	}
+	executable = argv[optind];
+	if (access(executable, F_OK) != 0) {
+		fprintf(stderr, "%s not found\n", executable);
+		return EXIT_FAILURE;
+	}
+	read_closure(executable);
+
+	if (num_threads < 1)
+		num_threads = 1;
+	if (num_threads > num_files)
+		num_threads = num_files;
+	threads = malloc(num_threads * sizeof(pthread_t));
+	for (i = 0; i < num_threads; i++)
+		pthread_create(&threads[i], NULL, scan_files, NULL);
+	for (i = 0; i < num_threads; i++)
+		pthread_join(threads[i], NULL);
+	free(threads);
+	find_depths();
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < num_files; i++) {
+		const struct elf_stats *stats = &files[i];
+
+		printf("---- processing %s, measurement unit in Byte ---\n", stats->path);
+		printf("Image Name: %s\n", stats->path);
+		printf("Image size: %lld\n", stats->image_size);
+		printf("Text size: %lld\n", stats->text_size);
+		printf("Data size: %lld\n", stats->data_size);
+		printf("Size of debug section: %lld\n", stats->debug_size);
+		printf("Size of uncompressed debug section: %lld\n", stats->debug_raw_size);
+		if (stats->has_dwo)
+			printf("Size of split DWARF file: %lld\n", stats->dwo_size);
+		printf("Size of symbol table: %lld\n", stats->symtab_size);
+		printf("Size of string table: %lld\n", stats->strtab_size);
+		if (stats->is_elf) {
+			print_loader(&stats->loader, "");
+			if (stats->depth >= 0)
+				printf("Dependency depth: %d\n", stats->depth);
+			else
+				printf("Dependency depth: not a DT_NEEDED entry\n");
+		}
+		total.image_size += stats->image_size;
+		total.text_size += stats->text_size;
+		total.data_size += stats->data_size;
+		total.debug_size += stats->debug_size;
+		total.debug_raw_size += stats->debug_raw_size;
+		total.dwo_size += stats->dwo_size;
+		total.symtab_size += stats->symtab_size;
+		total.strtab_size += stats->strtab_size;
+		add_loader(&total.loader, &stats->loader);
+		if (stats->loader.needed > max_needed)
+			max_needed = stats->loader.needed;
+		if (stats->depth > max_depth)
+			max_depth = stats->depth;
+	}
+
+	printf("\n\n************************************************\n");
+	printf("summary of %s executable and %d shared libraries\n", executable, num_files - 1);
+	print_total("aggregate total of shared libraries", total.image_size);
+	print_total("aggregate texts of shared libraries", total.text_size);
+	print_total("aggregate data of shared libraries", total.data_size);
+	print_total("aggregate debug sections of shared libraries", total.debug_size);
+	print_total("aggregate uncompressed debug sections of shared libraries", total.debug_raw_size);
+	print_total("aggregate split DWARF files of shared libraries", total.dwo_size);
+	print_total("aggregate symbol tables of shared libraries", total.symtab_size);
+	print_total("aggregate string table size of shared libraries", total.strtab_size);
+	print_loader(&total.loader, " of shared libraries");
+	printf("Largest number of DT_NEEDED entries of a shared library: %lld\n", max_needed);
+	printf("Dependency depth of shared libraries: %d\n", max_depth);
+	printf("************************************************\n");
+
+	if (json_file != NULL)
+		write_json(json_file, executable, &total, max_needed, max_depth);
+	return EXIT_SUCCESS;
+}
+
+/*************************************************
+COPYRIGHT
+
+Copyright (c) 2007, The Regents of the University of California.
+Produced at the Lawrence Livermore National Laboratory
+Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+UCRL-CODE-228991.
+All rights reserved.
+
+This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+
+Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+
+* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+
+THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*************************************************/
@@ -0,0 +1,181 @@
+#! /usr/bin/env python
+
+# Please see COPYRIGHT information at the end of this file.
+# File: pynamic_profile.py
+#
+# Profiles the shared libraries an existing executable loads and writes a
+# spec that so_generator.py --spec=<spec_file> turns into a Pynamic build
+# with the same per-library function counts, relocations, DT_NEEDED edges
+# and debug info.
+#
+# command: python pynamic_profile.py <executable> [-o <spec_file>] [-a]
+#
+
+import sys, os
+import re
+import json
+from subprocess import *
+
+# libraries under these directories are only profiled with -a
+system_dirs = ['/lib/', '/lib64/', '/usr/lib/', '/usr/lib64/']
+
+def print_usage():
+    print('\nUSAGE:\n\tpynamic_profile.py <executable> [options]\n')
+    print('OPTIONS:\n')
+    print('-o <spec_file>\n\twrite the spec to <spec_file>, default pynamic_spec.json\n')
+    print('-a\n\talso profile the libraries in the system directories %s\n' %(' '.join(system_dirs)))
+    sys.exit(-1)
+
+def command_output(command):
+    p = Popen(command, shell=True, stdout=PIPE, stderr=PIPE, universal_newlines=True)
+    out, err = p.communicate()
+    return out
+
+#the (name, path) of every library in the ldd closure of executable
+def ldd_closure(executable):
+    libraries = []
+    for line in command_output('ldd %s' %(executable)).splitlines():
+        m = re.match(r'\s*(\S+)\s+=>\s+(/\S+)', line)
+        if m != None:
+            libraries.append((m.group(1), m.group(2)))
+    return libraries
+
+#the number of defined functions and of all entries in the dynamic symbol table
+def dynamic_symbols(path):
+    functions = 0
+    symbols = 0
+    for line in command_output('readelf -W --dyn-syms %s' %(path)).splitlines():
+        fields = line.split()
+        if len(fields) < 8 or not fields[0].endswith(':') or fields[0] == '0:':
+            continue
+        symbols += 1
+        if fields[3] == 'FUNC' and fields[6] != 'UND':
+            functions += 1
+    return functions, symbols
+
+#the number of dynamic relocations, not counting the PLT ones
+def dynamic_relocations(path):
+    relocs = 0
+    for line in command_output('readelf -W -r %s' %(path)).splitlines():
+        m = re.match(r"Relocation section '([^']+)' at offset \S+ contains (\d+) entr", line)
+        if m != None and m.group(1).find('plt') == -1:
+            relocs += int(m.group(2))
+    return relocs
+
+#the DT_NEEDED entries of path
+def needed_libraries(path):
+    needed = []
+    for line in command_output('readelf -W -d %s' %(path)).splitlines():
+        m = re.search(r'\(NEEDED\)\s+Shared library: \[([^\]]+)\]', line)
+        if m != None:
+            needed.append(m.group(1))
+    return needed
+
+#the total size of the .debug sections of path
+def debug_size(path):
+    size = 0
+    for line in command_output('readelf -W -S %s' %(path)).splitlines():
+        m = re.search(r'\]\s+(\.debug\S*)\s+\S+\s+[0-9a-f]+\s+[0-9a-f]+\s+([0-9a-f]+)', line)
+        if m != None:
+            size += int(m.group(2), 16)
+    return size
+
+#the text and data sizes that size(1) reports for path
+def text_data_size(path):
+    lines = command_output('size %s' %(path)).splitlines()
+    if len(lines) < 2:
+        return 0, 0
+    fields = lines[1].split()
+    return int(fields[0]), int(fields[1]) + int(fields[2])
+
+#order the libraries so each one follows the libraries it needs
+def dependency_order(libraries):
+    names = [lib['name'] for lib in libraries]
+    by_name = dict([(lib['name'], lib) for lib in libraries])
+    ordered = []
+    state = {}
+    for name in names:
+        stack = [(name, 0)]
+        while len(stack) > 0:
+            name, next = stack.pop()
+            if next == 0:
+                if name in state:
+                    continue
+                state[name] = 'visiting'
+            needed = [dep for dep in by_name[name]['needed'] if dep in by_name]
+            if next < len(needed):
+                stack.append((name, next + 1))
+                if needed[next] not in state:
+                    stack.append((needed[next], 0))
+            else:
+                state[name] = 'done'
+                ordered.append(by_name[name])
+    return ordered
+
+def profile(executable, all_libraries):
+    libraries = []
+    for name, path in ldd_closure(executable):
+        if not all_libraries and len([d for d in system_dirs if path.startswith(d)]) > 0:
+            continue
+        lib = {'name': name, 'path': path}
+        lib['functions'], lib['dynsyms'] = dynamic_symbols(path)
+        lib['text'], lib['data'] = text_data_size(path)
+        lib['relocs'] = dynamic_relocations(path)
+        lib['needed'] = needed_libraries(path)
+        lib['debug'] = debug_size(path)
+        libraries.append(lib)
+        print('%s: %d functions, %d dynamic symbols, %d relocations, %d needed, %d bytes of debug info' %(name, lib['functions'], lib['dynsyms'], lib['relocs'], len(lib['needed']), lib['debug']))
+    libraries = dependency_order(libraries)
+    #only keep the edges between profiled libraries
+    names = [lib['name'] for lib in libraries]
+    for lib in libraries:
+        lib['needed'] = [dep for dep in lib['needed'] if dep in names]
+    return {'executable': os.path.abspath(executable), 'libraries': libraries}
+
+#MAIN FUNCTION
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print_usage()
+    executable = sys.argv[1]
+    spec_file = 'pynamic_spec.json'
+    all_libraries = False
+    next = 0
+    for i in range(2, len(sys.argv)):
+        if next > 0:
+            next = next - 1
+        elif sys.argv[i] == '-o' and i + 1 < len(sys.argv):
+            spec_file = sys.argv[i + 1]
+            next = 1
+        elif sys.argv[i] == '-a':
+            all_libraries = True
+        else:
+            print('Unknown option %s' %(sys.argv[i]))
+            print_usage()
+    if not os.path.exists(executable):
+        print('%s not found' %(executable))
+        sys.exit(-1)
+
+    spec = profile(executable, all_libraries)
+    f = open(spec_file, 'w')
+    json.dump(spec, f, indent=1, sort_keys=True)
+    f.close()
+    print('Profiled %d libraries of %s into %s' %(len(spec['libraries']), executable, spec_file))
+
+#
+#COPYRIGHT
+#
+#Copyright (c) 2007, The Regents of the University of California.
+#Produced at the Lawrence Livermore National Laboratory
+#Written by Gregory Lee, Dong Ahn, John Gyllenhaal, Bronis de Supinski.
+#UCRL-CODE-228991.
+#All rights reserved.
+#
+#This file is part of Pynamic.   For details contact Greg Lee (lee218@llnl.gov).  Please also read the "ADDITIONAL BSD NOTICE" in pynamic.LICENSE.
+#
+#Redistribution and use in source and binary forms, with or without modification, are permitted provided that the following conditions are met:
+#
+#* Redistributions of source code must retain the above copyright notice, this list of conditions and the disclaimer below.
+#* Redistributions in binary form must reproduce the above copyright notice, this list of conditions and the disclaimer (as noted below) in the documentation and/or other materials provided with the distribution.
+#* Neither the name of the UC/LLNL nor the names of its contributors may be used to endorse or promote products derived from this software without specific prior written permission.
+#
+#THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE REGENTS OF THE UNIVERSITY OF CALIFORNIA, THE U.S. DEPARTMENT OF ENERGY OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON  ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -8,13 +8,121 @@
 # and compiles them into shared object files.
 
 import sys, os, string
+import math
 import random
+import re
+import json
+import hashlib
+import shutil
+import compileall
+try:
+    from cStringIO import StringIO
+except ImportError:
+    from io import StringIO
 import multiprocessing as mp
 from subprocess import *
-from sysconfig import get_paths
+from sysconfig import get_paths, get_config_var
 
 var_types = ['int', 'long', 'float', 'double', 'char *']
 
+# directory holding the compile commands of every generated artifact
+cache_dir = '.pynamic_cache'
+
+# the generated build graph for all modules and libpynamic.a
+makefile_name = 'Makefile.pynamic'
+
+# the number of entries of the data every library exports with --relocs
+data_size = 16
+
+# the number of function pointers in each vtable-like struct with --relocs
+vtable_slots = 8
+
+# the iterations of every module's TLS entry function the driver times
+tls_iterations = 1000
+
+# the backtraces and exceptions the driver times at the end of the
+# --unwind-chain and --eh-chain chains
+unwind_runs = 10
+
+# the frames a backtrace can hold beyond the hops of the chain
+unwind_extra_frames = 256
+
+# the TLS models accepted by --tls-model
+tls_models = ['global-dynamic', 'local-dynamic', 'initial-exec']
+
+# libraries linked against more than this many others read their -l options
+# from a response file, keeping long commands under the kernel's limits
+max_link_args = 64
+
+# the response file listing the -l option of every module and utility
+libs_rsp_name = 'pynamic_libs.rsp'
+
+# the make fragment listing the same libraries as Makefile.mpi4py prerequisites
+libs_mk_name = 'pynamic_libs.mk'
+
+# the directory holding the --pkg-dirs and --decoy-dirs directories
+path_dir = 'pynamic_path'
+
+# the number of unrelated files in every decoy directory
+decoy_files = 8
+
+# the rtld-audit library built with the modules, see pynamic_audit.c
+audit_name = 'pynamic_audit'
+
+# the Python-free harness timing dlopen, dlsym and the entry functions of the
+# generated libraries, and the manifest it reads, see pynamic_dlopen.c
+dlopen_name = 'pynamic_dlopen'
+
+# the names of the --py-modules pure Python modules, and their default
+# functions, classes, imported modules and statements per function
+py_module_prefix = 'pynamic_py'
+py_module_defaults = [20, 4, 2, 8]
+
+# the header precompiled once per configuration for every Python module
+pch_header_name = 'pynamic_pch.h'
+
+# the DWARF versions accepted by --dwarf
+dwarf_versions = [2, 3, 4, 5]
+
+# the debug section compressions accepted by --compress-debug
+debug_compressions = ['none', 'zlib', 'zstd']
+
+# the object registering the unwind tables of modules linked with
+# --no-eh-frame-hdr, see pynamic_eh_frame.c
+eh_frame_name = 'pynamic_eh_frame'
+
+# the languages accepted by --lang
+langs = ['c', 'c++']
+
+# the approximate .text and .debug bytes gcc -g emits for a generated
+# function, for each filler statement and for each debug record a function
+# uses, from which --spec scales the modules to the profiled sizes
+spec_function_text = 190
+spec_function_debug = 500
+spec_filler_text = 17
+spec_filler_debug = 14
+spec_record_text = 46
+spec_record_debug = 460
+# size(1) counts the Elf64_Rela of each relocation as text and the pointer
+# it relocates as data
+spec_reloc_text = 24
+spec_reloc_data = 8
+spec_max_fillers = 4096
+spec_max_records = 64
+
+# the class templates every C++ module shares, defined in cxx_header_name
+cxx_header_name = 'pynamic_cxx.h'
+
+# the number of template arguments C++ modules pick their shared
+# instantiations from, so the same instantiation appears in many libraries
+cxx_shared_templates = 16
+
+# the types the generated C++ classes compute with
+cxx_types = ['int', 'long', 'double']
+
+# the mangled code of each type in cxx_types and var_types
+cxx_type_codes = {'int': 'i', 'long': 'l', 'float': 'f', 'double': 'd', 'char *': 'Pc'}
+
 def run_command(command, exit_on_error=True):
     print(command)
     ret = os.system(command)
@@ -35,8 +143,19 @@ def write_function_declaration(f, function_name, function):
             f.write(', ')
     f.write(')')
 
+#the Itanium C++ ABI name of a function in the global namespace.  char * is
+#the only compound type, so its repetitions refer back to the first as S_
+def mangle_function(function_name, function):
+    codes = ''
+    for type in function[2:function[1] + 2]:
+        if type == 'char *' and codes.find('Pc') != -1:
+            codes += 'S_'
+        else:
+            codes += cxx_type_codes[type]
+    return '_Z%d%s%s' %(len(function_name), function_name, codes or 'v')
+
 #write a function call to a file
-def write_function_call(f, function_name, function):
+def write_function_call(f, function_name, function, rng):
     function_type = function[0]
     f.write('\t' + function_type + ' ' + function_name + 'val' + ' = ')
     f.write(function_name + '(')
@@ -44,44 +163,242 @@ def write_function_call(f, function_name, function):
     for arg_num in range(num_args):
         type = function[arg_num + 2]
         if type == 'int' or type == 'long':
-            f.write(str(random.randint(0,16000)))
+            f.write(str(rng.randint(0,16000)))
         elif type == 'float' or type == 'double':
-            f.write(str(random.random()))
+            f.write(str(rng.random()))
         else:
-            f.write('"hello"')
+            f.write('(char *) "hello"')
         if arg_num != num_args - 1:
             f.write(', ')
     f.write(');\n')
 
+#the random stream for one module, derived only from the seed and the module
+#name so a module's content does not depend on any other module
+def module_random(seedval, file_prefix, my_id):
+    return random.Random('%d:%s%d' %(seedval, file_prefix, my_id))
+
+#pick the number of functions and their signatures from a module's stream
+def create_module_functions(rng, avg_num_functions):
+    num_functions = rng.randint(avg_num_functions//2, avg_num_functions*3//2)
+    return create_function_list(num_functions, rng)
+
+#give a generator worker the signatures and dependencies shared between modules
+def init_generator_worker(utilities, externs, dependencies):
+    global utility_list
+    global extern_list
+    global dependency_list
+    utility_list = utilities
+    extern_list = externs
+    dependency_list = dependencies
+
+#write the relocation heavy data of a library: a function pointer table in
+#.data, vtable-like const structs in .data.rel.ro and pointers to data in other
+#libraries, each taking a third of num_relocs relocations.  Returns the name
+#and size of each kind of table
+def write_relocation_data(f, file_prefix, function_names, num_relocs, xref_targets, rng, export):
+    num_fptrs = max(1, num_relocs // 3)
+    num_vtables = max(1, (num_relocs // 3 + vtable_slots - 1) // vtable_slots)
+    num_xrefs = max(1, num_relocs - num_fptrs - num_vtables * vtable_slots)
+
+    f.write(export + 'int ' + file_prefix + '_data[%d] = {%s};\n\n' %(data_size, ', '.join([str(i) for i in range(data_size)])))
+
+    f.write('void *' + file_prefix + '_fptrs[%d] = {\n' %(num_fptrs))
+    for i in range(num_fptrs):
+        f.write('\t(void *) %s,\n' %(function_names[i % len(function_names)]))
+    f.write('};\n\n')
+
+    f.write('#ifndef PYNAMIC_VTABLE_SLOTS\n#define PYNAMIC_VTABLE_SLOTS %d\n' %(vtable_slots))
+    f.write('struct pynamic_vtable {\n\tvoid *slot[PYNAMIC_VTABLE_SLOTS];\n};\n#endif\n\n')
+    for k in range(num_vtables):
+        f.write('const struct pynamic_vtable ' + file_prefix + '_vtable%d = {{\n' %(k))
+        for i in range(vtable_slots):
+            f.write('\t(void *) %s,\n' %(function_names[rng.randint(0, len(function_names) - 1)]))
+        f.write('}};\n\n')
+
+    f.write('int *' + file_prefix + '_xrefs[%d] = {\n' %(num_xrefs))
+    for i in range(num_xrefs):
+        f.write('\t&%s[%d],\n' %(xref_targets[rng.randint(0, len(xref_targets) - 1)], rng.randint(0, data_size - 1)))
+    f.write('};\n\n')
+    return [(file_prefix + '_fptrs', num_fptrs), (file_prefix + '_vtable', num_vtables), (file_prefix + '_xrefs', num_xrefs)]
+
+#the Itanium C++ ABI mangled name of the const method
+#pynamic::<namespace>::<class_name>::<method>(<type>)
+def mangled_method_name(namespace, class_name, method, type):
+    name = '_ZNK7pynamic'
+    for ident in [namespace, class_name, method]:
+        name += '%d%s' %(len(ident), ident)
+    return name + 'E' + cxx_type_codes[type]
+
+#name the i-th class of a C++ module, padding it so its mangled method names
+#are about target characters long
+def cxx_class_name(namespace, i, target):
+    class_name = 'Class%d' %(i)
+    pad = target - len(mangled_method_name(namespace, class_name, 'compute', 'int'))
+    if pad > 0:
+        class_name += ''.join([string.ascii_lowercase[j % 26] for j in range(pad)])
+        #the length prefix of the identifier may have grown a digit
+        while len(mangled_method_name(namespace, class_name, 'compute', 'int')) > target and len(class_name) > len('Class%d' %(i)):
+            class_name = class_name[:-1]
+    return class_name
+
+#write the header with the class templates every C++ module instantiates
+def write_cxx_header():
+    text = """#ifndef PYNAMIC_CXX_H
+#define PYNAMIC_CXX_H
+
+#ifdef __cplusplus
+#include <time.h>
+
+namespace pynamic {
+
+/* the exception the --eh-chain hops throw, with the time it was thrown */
+struct pynamic_error {
+	struct timespec start;
+};
+
+class pynamic_object {
+public:
+	virtual ~pynamic_object() {}
+	virtual long visit(long value) const = 0;
+};
+
+template <typename T>
+class pynamic_base : public pynamic_object {
+public:
+	virtual T compute(T value) const = 0;
+	virtual long visit(long value) const { return (long) compute((T) value); }
+};
+
+/* instantiated with the same arguments in many libraries, so each of them
+   carries a weak copy of the code, vtable and typeinfo the loader has to
+   resolve to a single definition */
+template <typename T, int N>
+class pynamic_shared : public pynamic_base<T> {
+public:
+	virtual T compute(T value) const { return value * (T) N + (T) (N % 7); }
+};
+
+template <typename T, int N>
+T pynamic_reduce(T value)
+{
+	pynamic_shared<T, N> shared;
+	const pynamic_base<T> &object = shared;
+	for (int i = 0; i < N % 4 + 1; i++)
+		value = object.compute(value);
+	return value;
+}
+
+}
+#endif
+
+#endif
+"""
+    write_if_changed(cxx_header_name, text)
+
+#write the classes of a C++ module, each with a vtable and typeinfo and a
+#virtual compute() calling a shared template instantiation.  Returns the
+#class names and the lengths of their mangled compute() names
+def write_cxx_classes(f, file_prefix, num_classes, function_names, functions, mangled_length, rng):
+    class_names = []
+    lengths = []
+    f.write('namespace pynamic {\nnamespace ' + file_prefix + ' {\n\n')
+    for i in range(num_classes):
+        target = 0
+        if mangled_length != None:
+            target = int(rng.lognormvariate(math.log(mangled_length[0]), mangled_length[1]))
+        class_name = cxx_class_name(file_prefix, i, target)
+        type = cxx_types[rng.randint(0, len(cxx_types) - 1)]
+        f.write('class ' + class_name + ' : public pynamic_base<' + type + '> {\n')
+        f.write('public:\n')
+        f.write('\tvirtual ' + type + ' compute(' + type + ' value) const;\n')
+        f.write('};\n\n')
+
+        #the out of line virtual is the key function that emits the vtable
+        f.write(type + ' ' + class_name + '::compute(' + type + ' value) const\n{\n')
+        callee = i % len(function_names)
+        write_function_call(f, function_names[callee], functions[callee], rng)
+        f.write('\treturn pynamic_reduce<' + type + ', %d>(value) + (%s) %d;\n' %(rng.randint(0, cxx_shared_templates - 1), type, i))
+        f.write('}\n\n')
+        class_names.append(class_name)
+        lengths.append(len(mangled_method_name(file_prefix, class_name, 'compute', type)))
+    f.write('}\n}\n\n')
+    return class_names, lengths
+
+#write the struct types and always inlined helpers that give a library rich
+#debug info: nested and anonymous aggregates, unions, enums, typedefs, self
+#references, inlined subroutines and lexical blocks
+def write_debug_types(f, file_prefix, num_types):
+    for k in range(num_types):
+        record = '%s_record%d' %(file_prefix, k)
+        f.write('typedef struct ' + record + ' {\n')
+        f.write('\tint id;\n')
+        f.write('\tdouble weight;\n')
+        f.write('\tstruct {\n\t\tfloat x, y, z;\n\t} position;\n')
+        f.write('\tunion {\n\t\tlong l;\n\t\tdouble d;\n\t\tchar c[8];\n\t} value;\n')
+        f.write('\tenum { %s_red, %s_green, %s_blue } color;\n' %(record, record, record))
+        f.write('\tstruct ' + record + ' *next;\n')
+        f.write('\tchar name[16];\n')
+        f.write('} ' + record + '_t;\n\n')
+
+        f.write('static inline __attribute__((always_inline)) int %s_inline%d(%s_t *record, int a)\n{\n' %(file_prefix, k, record))
+        f.write('\trecord->id += a;\n')
+        f.write('\t{\n')
+        f.write('\t\tdouble scaled = record->weight * a;\n')
+        f.write('\t\trecord->value.d = scaled;\n')
+        f.write('\t\trecord->position.x = (float) scaled;\n')
+        f.write('\t}\n')
+        f.write('\treturn record->id;\n}\n\n')
+
 # create a .c file for use within Python
-def generate_c_file(file_prefix_in, my_id, num_functions, call_depth, extern, utility_enabled, fun_print, name_length):
+def generate_c_file(file_prefix_in, my_id, avg_num_functions, call_depth, extern, utility_enabled, fun_print, name_length, seedval, symbol_model='default', num_relocs=0, num_tls=0, lang='c', mangled_length=None, rich_debug=False, num_functions=None, unwind_hop=False, eh_hop=False, num_fillers=0, num_records=0, spec_data_size=0):
     global extern_list
     global utility_list
+    global dependency_list
+    rng = module_random(seedval, file_prefix_in, my_id)
     file_prefix = file_prefix_in + str(my_id)
-    filename = file_prefix + '.c'
-    f = open(filename, 'w')
+    #the utilities stay C libraries in C++ mode
+    if file_prefix_in != 'libmodule':
+        lang = 'c'
+    filename = file_prefix + source_suffix(lang)
+    f = StringIO()
+
+    #with -fvisibility=hidden only the symbols other objects use are exported
+    export = ''
+    export_header = ''
+    if symbol_model == 'hidden':
+        export = 'PYNAMIC_EXPORT '
+        export_header = '#ifndef PYNAMIC_EXPORT\n#define PYNAMIC_EXPORT __attribute__((visibility("default")))\n#endif\n'
+    exports = []
 
     if file_prefix_in == 'libmodule':
         header = '#include <Python.h>\n'
+        if unwind_hop:
+            header += '#include <execinfo.h>\n#include <time.h>\n'
         if utility_enabled:
             header += '#include "pynamic.h"\n'
+        if lang == 'c++':
+            header += '#include "' + cxx_header_name + '"\n'
+        header += export_header
     else:
         header = '#include "' + file_prefix + '.h"\n\n'
     f.write(header)
 
     if file_prefix_in == 'libmodule':
-        #declare external function to call if not first module
-        if my_id != 0 and extern:
-            f.write('extern ')
-            function_name = file_prefix_in + str(my_id - 1) + '_extern'
-            function = extern_list[my_id - 1]
-            write_function_declaration(f, function_name, function)
-            f.write(';\n')
+        #declare the external functions of the modules this one depends on
+        if extern:
+            for dep in dependency_list[my_id]:
+                f.write('extern ')
+                function_name = file_prefix_in + str(dep) + '_extern'
+                function = extern_list[dep]
+                write_function_declaration(f, function_name, function)
+                f.write(';\n')
 
         #define my external function
         if extern:
             function_name = file_prefix + '_extern'
             function = extern_list[my_id]
+            exports.append(function_name)
+            f.write(export)
             write_function_declaration(f, function_name, function)
             f.write('\n{\n')
             f.write('\t' + function[0] + ' ret_val;')
@@ -91,9 +408,11 @@ def generate_c_file(file_prefix_in, my_id, num_functions, call_depth, extern, ut
             f.write('}\n\n')
 
     #prepare function definitions
-    functions = create_function_list(num_functions)
-    if file_prefix_in == 'libutility':
-        utility_list.append(functions)
+    if num_functions == None:
+        functions = create_module_functions(rng, avg_num_functions)
+    else:
+        functions = create_function_list(num_functions, rng)
+    num_functions = len(functions)
 
     #function declarations
     if file_prefix_in == 'libmodule':
@@ -105,19 +424,43 @@ def generate_c_file(file_prefix_in, my_id, num_functions, call_depth, extern, ut
             write_function_declaration(f, function_name, function)
             f.write(';\n')
         f.write('\n')
+
+        #thread-local variables, half in .tdata and half in .tbss
+        for k in range(num_tls):
+            if k % 2 == 0:
+                f.write('__thread int %s_tls%d = %d;\n' %(file_prefix, k, k + 1))
+            else:
+                f.write('__thread int %s_tls%d;\n' %(file_prefix, k))
+        if num_tls > 0:
+            f.write('\n')
     else:
         utility_header_name = file_prefix + '.h'
-        utility_header_file = open(utility_header_name, 'w')
+        utility_header_file = StringIO()
         utility_header_file.write('#include <stdio.h>\n#include <stdlib.h>\n\n')
+        utility_header_file.write(export_header)
+        utility_header_file.write('#ifdef __cplusplus\nextern "C" {\n#endif\n')
+        if num_relocs > 0:
+            utility_header_file.write('extern ' + export + 'int ' + file_prefix + '_data[];\n')
         for i in range(num_functions):
             function_name = file_prefix + '_fun' + str(i)
             for j in range(name_length):
                 function_name += str(j%10)
             function = functions[i]
+            exports.append(function_name)
+            utility_header_file.write(export)
             write_function_declaration(utility_header_file, function_name, function)
             utility_header_file.write(';\n')
-        utility_header_file.write('\n')
-        utility_header_file.close()
+        utility_header_file.write('#ifdef __cplusplus\n}\n#endif\n\n')
+        write_if_changed(utility_header_name, utility_header_file.getvalue())
+
+    #--spec gives every function num_records debug records of its own
+    num_debug_types = 0
+    if num_records > 0:
+        num_debug_types = num_functions * num_records
+    elif rich_debug:
+        num_debug_types = max(1, num_functions // 4)
+    if num_debug_types > 0:
+        write_debug_types(f, file_prefix, num_debug_types)
 
     for i in range(num_functions):
         #function declaration
@@ -141,17 +484,39 @@ def generate_c_file(file_prefix_in, my_id, num_functions, call_depth, extern, ut
             f.write('\tprintf("In module ' + file_prefix + ' function ' + function_name + '\\n");\n')
         f.write('\tfor (loop = 0; loop < 10; loop++)\n\t{\n')
         f.write('\t\ta = loop;\n')
+        if file_prefix_in == 'libmodule' and num_tls > 0:
+            f.write('\t\t%s_tls%d += a;\n' %(file_prefix, i % num_tls))
+        #the --spec records only reference their type, which emits its
+        #debug info with little code
+        for m in range(num_records):
+            record = '%s_record%d' %(file_prefix, i * num_records + m)
+            f.write('\t\t{\n')
+            f.write('\t\t\t' + record + '_t *rec = (' + record + '_t *) 0;\n')
+            f.write('\t\t\tb = rec != 0;\n')
+            f.write('\t\t}\n')
+        if num_records == 0 and num_debug_types > 0:
+            record = '%s_record%d' %(file_prefix, i % num_debug_types)
+            f.write('\t\t{\n')
+            f.write('\t\t\t' + record + '_t rec = {0};\n')
+            f.write('\t\t\trec.weight = a;\n')
+            f.write('\t\t\tb = %s_inline%d(&rec, a);\n' %(file_prefix, i % num_debug_types))
+            f.write('\t\t}\n')
+        #filler statements that grow the function to the --spec text size
+        if num_fillers > 0:
+            f.write('\t\tc = a;\n')
+        for m in range(num_fillers):
+            f.write('\t\tc = c * %d + a;\n' %(m + 3))
 
         if file_prefix_in == 'libmodule' and utility_enabled:
-            utility_num = random.randint(0, len(utility_list) - 1)
+            utility_num = rng.randint(0, len(utility_list) - 1)
             utility_file = utility_list[utility_num]
-            utility_fun_num = random.randint(0, len(utility_file) - 1)
+            utility_fun_num = rng.randint(0, len(utility_file) - 1)
             callee = utility_file[utility_fun_num]
             callee_name = 'libutility' + str(utility_num) + '_fun' + str(utility_fun_num)
             for j in range(name_length):
                 callee_name += str(j%10)
             f.write('\t')
-            write_function_call(f, callee_name, callee)
+            write_function_call(f, callee_name, callee, rng)
 
         f.write('\t}\n')
 
@@ -162,43 +527,186 @@ def generate_c_file(file_prefix_in, my_id, num_functions, call_depth, extern, ut
             callee_name = file_prefix + '_fun' + str(i + 1)
             for j in range(name_length):
                 callee_name += str(j%10)
-            write_function_call(f, callee_name, callee)
+            write_function_call(f, callee_name, callee, rng)
 
         f.write('\treturn ret_val;\n}\n\n')
 
+    #initialized data of the --spec data size, in .data
+    if spec_data_size > 0:
+        f.write('char %s_spec_data[%d] = {1};\n\n' %(file_prefix, spec_data_size))
+
+    if num_relocs > 0:
+        function_names = []
+        for i in range(num_functions):
+            function_name = file_prefix + '_fun' + str(i)
+            for j in range(name_length):
+                function_name += str(j%10)
+            function_names.append(function_name)
+        #data in other libraries, preferably the utilities every module links
+        if file_prefix_in == 'libmodule' and utility_enabled:
+            xref_targets = ['libutility%d_data' %(i) for i in range(len(utility_list))]
+        elif file_prefix_in == 'libmodule' and extern and len(dependency_list[my_id]) > 0:
+            xref_targets = ['libmodule%d_data' %(dep) for dep in dependency_list[my_id]]
+            for target in xref_targets:
+                f.write('extern int ' + target + '[];\n')
+        else:
+            xref_targets = [file_prefix + '_data']
+        exports.append(file_prefix + '_data')
+        tables = write_relocation_data(f, file_prefix, function_names, num_relocs, xref_targets, rng, export)
+
+    class_names = []
+    mangled_lengths = []
+    if lang == 'c++':
+        function_names = []
+        for i in range(num_functions):
+            function_name = file_prefix + '_fun' + str(i)
+            for j in range(name_length):
+                function_name += str(j%10)
+            function_names.append(function_name)
+        class_names, mangled_lengths = write_cxx_classes(f, file_prefix, max(1, num_functions // 4), function_names, functions, mangled_length, rng)
+
     if file_prefix_in == 'libmodule':
-        #Python callable entry function
-        function_name = file_prefix + '_entry'
-        f.write('static PyObject *py_' + function_name + '(')
-        f.write('PyObject *self, PyObject *args)\n{\n')
+        #C callable entry function, which pynamic_dlopen calls without Python
+        centry_name = file_prefix + '_centry'
+        exports.append(centry_name)
+        if lang == 'c++':
+            f.write('extern "C" ')
+        f.write(export + 'int ' + centry_name + '()\n{\n')
         f.write('\tint ret_val = 0;\n')
+        if num_relocs > 0:
+            #touch every relocated pointer
+            f.write('\tint r;\n')
+            f.write('\tfor (r = 0; r < %d; r++)\n' %(tables[0][1]))
+            f.write('\t\tret_val += %s[r] != 0;\n' %(tables[0][0]))
+            for k in range(tables[1][1]):
+                f.write('\tfor (r = 0; r < PYNAMIC_VTABLE_SLOTS; r++)\n')
+                f.write('\t\tret_val += %s%d.slot[r] != 0;\n' %(tables[1][0], k))
+            f.write('\tfor (r = 0; r < %d; r++)\n' %(tables[2][1]))
+            f.write('\t\tret_val += *%s[r];\n' %(tables[2][0]))
+        if lang == 'c++':
+            #construct every class and call it through its vtable
+            f.write('\tpynamic::pynamic_object *objects[%d] = {\n' %(len(class_names)))
+            for class_name in class_names:
+                f.write('\t\tnew pynamic::' + file_prefix + '::' + class_name + '(),\n')
+            f.write('\t};\n')
+            f.write('\tfor (int o = 0; o < %d; o++)\n\t{\n' %(len(class_names)))
+            f.write('\t\tret_val += (int) objects[o]->visit(o);\n')
+            f.write('\t\tdelete objects[o];\n\t}\n')
         for i in range(num_functions):
             if i % call_depth == 0:
                 callee = functions[i]
                 callee_name = file_prefix + '_fun' + str(i)
                 for j in range(name_length):
                     callee_name += str(j%10)
-                write_function_call(f, callee_name, callee)
+                write_function_call(f, callee_name, callee, rng)
 
-        #call the previous module's extern function
-        if my_id != 0 and extern:
-            callee = extern_list[my_id - 1]
-            callee_name = file_prefix_in + str(my_id - 1) + '_extern'
-            write_function_call(f, callee_name, callee)
+        #call the extern functions of the modules this one depends on
+        if extern:
+            for dep in dependency_list[my_id]:
+                callee = extern_list[dep]
+                callee_name = file_prefix_in + str(dep) + '_extern'
+                write_function_call(f, callee_name, callee, rng)
+        f.write('\treturn ret_val;\n}\n\n')
 
-        f.write('\treturn Py_BuildValue("i", ret_val);\n}\n\n')
+        #Python callable entry function
+        function_name = file_prefix + '_entry'
+        f.write('static PyObject *py_' + function_name + '(')
+        f.write('PyObject *self, PyObject *args)\n{\n')
+        f.write('\treturn Py_BuildValue("i", ' + centry_name + '());\n}\n\n')
+
+        #Python callable function touching every thread-local variable
+        if num_tls > 0:
+            tls_function_name = file_prefix + '_tls_entry'
+            f.write('static PyObject *py_' + tls_function_name + '(')
+            f.write('PyObject *self, PyObject *args)\n{\n')
+            f.write('\tint iterations, loop;\n')
+            f.write('\tlong ret_val = 0;\n\n')
+            f.write('\tif (!PyArg_ParseTuple(args, "i", &iterations))\n')
+            f.write('\t\treturn NULL;\n')
+            f.write('\tfor (loop = 0; loop < iterations; loop++)\n\t{\n')
+            for k in range(num_tls):
+                f.write('\t\t%s_tls%d += loop;\n' %(file_prefix, k))
+                f.write('\t\tret_val += %s_tls%d;\n' %(file_prefix, k))
+            f.write('\t}\n')
+            f.write('\treturn Py_BuildValue("l", ret_val);\n}\n\n')
+
+        #one hop of the --unwind-chain call chain, which calls the hop of
+        #the next module through the chain the driver builds from their
+        #addresses; the last hop times a backtrace of the whole chain
+        if unwind_hop:
+            hop_name = file_prefix + '_hop'
+            f.write('static long ' + hop_name + '(void **chain, int hop, int num_hops, int *frames)\n{\n')
+            f.write('\tvolatile long ret_val;\n\n')
+            f.write('\tif (hop + 1 < num_hops)\n')
+            f.write('\t\tret_val = ((long (*)(void **, int, int, int *)) chain[hop + 1])(chain, hop + 1, num_hops, frames);\n')
+            f.write('\telse\n\t{\n')
+            f.write('\t\tvoid **trace = (void **) malloc((num_hops + %d) * sizeof(void *));\n' %(unwind_extra_frames))
+            f.write('\t\tstruct timespec start, end;\n')
+            f.write('\t\tclock_gettime(CLOCK_MONOTONIC, &start);\n')
+            f.write('\t\t*frames = backtrace(trace, num_hops + %d);\n' %(unwind_extra_frames))
+            f.write('\t\tclock_gettime(CLOCK_MONOTONIC, &end);\n')
+            f.write('\t\tfree(trace);\n')
+            f.write('\t\tret_val = (end.tv_sec - start.tv_sec) * 1000000000L + end.tv_nsec - start.tv_nsec;\n')
+            f.write('\t}\n')
+            f.write('\treturn ret_val;\n}\n\n')
+            hop_address_name = hop_name + '_address'
+            f.write('static PyObject *py_' + hop_address_name + '(')
+            f.write('PyObject *self, PyObject *args)\n{\n')
+            f.write('\treturn PyLong_FromVoidPtr((void *) ' + hop_name + ');\n}\n\n')
+
+        #the --eh-chain hops, which throw from the last hop of the chain to
+        #the catch in the first one, several libraries up the stack
+        if eh_hop:
+            eh_hop_name = file_prefix + '_eh_hop'
+            f.write('static long ' + eh_hop_name + '(void **chain, int hop, int num_hops, int *frames)\n{\n')
+            f.write('\tvolatile long ret_val = 0;\n\n')
+            f.write('\tif (hop + 1 < num_hops)\n')
+            f.write('\t\tret_val = ((long (*)(void **, int, int, int *)) chain[hop + 1])(chain, hop + 1, num_hops, frames);\n')
+            f.write('\telse\n\t{\n')
+            f.write('\t\tpynamic::pynamic_error error;\n')
+            f.write('\t\tclock_gettime(CLOCK_MONOTONIC, &error.start);\n')
+            f.write('\t\tthrow error;\n')
+            f.write('\t}\n')
+            f.write('\treturn ret_val;\n}\n\n')
+            eh_catch_name = file_prefix + '_eh_catch'
+            f.write('static long ' + eh_catch_name + '(void **chain, int hop, int num_hops, int *frames)\n{\n')
+            f.write('\tvolatile long ret_val = 0;\n\n')
+            f.write('\ttry\n\t{\n')
+            f.write('\t\tret_val = ' + eh_hop_name + '(chain, hop, num_hops, frames);\n')
+            f.write('\t}\n')
+            f.write('\tcatch (const pynamic::pynamic_error &error)\n\t{\n')
+            f.write('\t\tstruct timespec end;\n')
+            f.write('\t\tclock_gettime(CLOCK_MONOTONIC, &end);\n')
+            f.write('\t\tret_val = (end.tv_sec - error.start.tv_sec) * 1000000000L + end.tv_nsec - error.start.tv_nsec;\n')
+            f.write('\t}\n')
+            f.write('\treturn ret_val;\n}\n\n')
+            for name in [eh_hop_name, eh_catch_name]:
+                f.write('static PyObject *py_' + name + '_address(')
+                f.write('PyObject *self, PyObject *args)\n{\n')
+                f.write('\treturn PyLong_FromVoidPtr((void *) ' + name + ');\n}\n\n')
 
         #Python module initialization code
         f.write('static PyMethodDef ' + file_prefix + 'Methods[] = {\n')
         f.write('\t{"' + function_name + '", py_' + function_name + ', METH_VARARGS, "a function."},\n')
+        if unwind_hop:
+            f.write('\t{"' + hop_address_name + '", py_' + hop_address_name + ', METH_VARARGS, "the address of the unwind chain hop."},\n')
+        if eh_hop:
+            for name in [eh_hop_name, eh_catch_name]:
+                f.write('\t{"' + name + '_address", py_' + name + '_address, METH_VARARGS, "the address of the exception chain hop."},\n')
+        if num_tls > 0:
+            f.write('\t{"' + tls_function_name + '", py_' + tls_function_name + ', METH_VARARGS, "touch the thread-local variables."},\n')
         f.write('\t{NULL, NULL, 0, NULL}\n')
         f.write('};\n\n')
         if sys.version_info.major == 2:
-            f.write('void init' + file_prefix + '()\n')
+            exports.append('init' + file_prefix)
+            if lang == 'c++':
+                f.write('extern "C" ')
+            f.write(export + 'void init' + file_prefix + '()\n')
             f.write('{\n')
             f.write('\tPy_InitModule("' + file_prefix + '", ' + file_prefix + 'Methods);\n')
             f.write('}\n\n')
         else:
+            exports.append('PyInit_' + file_prefix)
             f.write('PyMODINIT_FUNC PyInit_' + file_prefix + '()\n')
             f.write('{\n')
             f.write('\tstatic struct PyModuleDef mod = {\n')
@@ -210,45 +718,261 @@ def generate_c_file(file_prefix_in, my_id, num_functions, call_depth, extern, ut
             f.write('};\n')
             f.write('return PyModule_Create(&mod);\n')
             f.write('}\n\n')
+    write_if_changed(filename, f.getvalue())
+
+    if symbol_model == 'version-script':
+        text = '{\n\tglobal:\n'
+        for name in exports:
+            if lang == 'c++' and name.endswith('_extern'):
+                #C++ mangles the extern function, match its demangled name
+                text += '\t\textern "C++" {\n\t\t\t%s*;\n\t\t};\n' %(name)
+            else:
+                text += '\t\t%s;\n' %(name)
+        text += '\tlocal: *;\n};\n'
+        write_if_changed(file_prefix + '.map', text)
+
+    #the functions pynamic_dlopen looks up, whether exported or not, by
+    #their mangled names in C++ modules
+    symbols = []
+    if file_prefix_in == 'libmodule' and extern:
+        symbols.append((file_prefix + '_extern', extern_list[my_id]))
+    for i in range(num_functions):
+        function_name = file_prefix + '_fun' + str(i)
+        for j in range(name_length):
+            function_name += str(j%10)
+        symbols.append((function_name, functions[i]))
+    if lang == 'c++':
+        symbols = [mangle_function(name, function) for name, function in symbols]
+    else:
+        symbols = [name for name, function in symbols]
+    return mangled_lengths, symbols
+
+#the suffix of the generated sources of lang
+def source_suffix(lang):
+    if lang == 'c++':
+        return '.cpp'
+    return '.c'
+
+#write text to filename, leaving the file (and its mtime) untouched when the
+#content is unchanged so the generated Makefile only rebuilds what changed
+def write_if_changed(filename, text):
+    if os.path.exists(filename):
+        f = open(filename, 'r')
+        old_text = f.read()
+        f.close()
+        if old_text == text:
+            return False
+    f = open(filename, 'w')
+    f.write(text)
     f.close()
+    return True
 
-# compile a .c file into a Python-usable .so file
-def compile_file(file_prefix, num_module_files, num_utility_files, include_dir, CC):
-    filename = file_prefix + '.c'
+# write the Makefile rules that compile a .c file once into a PIC object and
+# link that object into a Python-usable .so file
+def compile_file(mk, file_prefix, link_modules, num_utility_files, include_dir, CC, use_pch=False, cflags='', ldflags='', link_deps=[], lang='c', debug='-g'):
+    filename = file_prefix + source_suffix(lang)
     cwd = os.getcwd()
+    objfile = file_prefix + '.o'
     outfile = file_prefix + '.so'
+    headers = []
+    so_deps = []
+
+    # create .o file
+    o_command = '%s %s -fPIC -c' %(CC, debug) + cflags
+    if file_prefix.find('module') != -1 and use_pch:
+        #gcc picks up pynamic_pch.h.gch for the forced include, or parses
+        #pynamic_pch.h itself if the precompiled header can't be used
+        o_command += ' -include %s -Winvalid-pch' %(pch_header_name)
+        headers.append(pch_header_name + '.gch')
+    o_command += ' -o ' + objfile + ' ' + filename
+    o_command += ' -I%s' %(include_dir)
+    if lang == 'c++':
+        headers.append(cxx_header_name)
+    if file_prefix.find('utility') != -1:
+        headers.append(file_prefix + '.h')
+    elif file_prefix.find('module') != -1 and num_utility_files > 0:
+        #pynamic.h only adds the utility headers and init prototypes, so the
+        #utility headers are all a module's object code can depend on
+        for i in range(num_utility_files):
+            headers.append('libutility%d.h' %(i))
+    #the generated headers are hashed, the precompiled one is built by make
+    sources = [filename] + [header for header in headers if not header.endswith('.gch')]
+    if pch_header_name + '.gch' in headers:
+        sources.append(pch_header_name)
+
     if (CC.find('xl')) != -1:
-        command = '%s -g -qmkshrobj' %(CC)
+        command = '%s %s -qmkshrobj' %(CC, debug)
     else:
-        command = '%s -g -fPIC -shared' %(CC)
+        #the soname lets the loader match a library pynamic_bcast.py loaded
+        #from a memfd against the DT_NEEDED entries of the other libraries
+        command = '%s %s -fPIC -shared -Wl,-soname,%s' %(CC, debug, outfile)
+    command += ldflags
+    so_deps += link_deps
+    command += ' -o ' + outfile + ' ' + objfile
     if file_prefix.find('module') != -1:
-        if file_prefix.find('begin') != -1:
-            for i in range(num_module_files):
-                command += ' -lmodule' + str(i)
-        command += ' -I%s' %(include_dir)
         command += ' -Wl,-rpath=' + cwd + ' -L' + cwd
+        libs = []
+        for i in link_modules:
+            libs.append('-lmodule' + str(i))
+            so_deps.append('libmodule%d.so' %(i))
         for i in range(num_utility_files):
-            command += ' -lutility' + str(i)
-
-    command += ' -o ' + outfile + ' ' + filename
-    run_command(command)
-
-    # create .o file
-    outfile = file_prefix + '.o'
-    command = '%s -g -fPIC -c' %(CC)
-    command += ' -o ' + outfile + ' ' + filename
-    command += ' -I%s' %(include_dir)
-    run_command(command)
+            libs.append('-lutility' + str(i))
+            so_deps.append('libutility%d.so' %(i))
+        if len(libs) > max_link_args:
+            rsp_file = file_prefix + '.rsp'
+            write_if_changed(rsp_file, '\n'.join(libs) + '\n')
+            command += ' @' + rsp_file
+            so_deps.append(rsp_file)
+        else:
+            command += ''.join([' ' + lib for lib in libs])
+    so_command = command
+
+    # the cache key of the artifacts is the SHA-1 of the source, the headers
+    # and both commands.  Make only sees the digest file, so touching a
+    # source does not rebuild, and a changed digest removes the stale
+    # artifacts so they are rebuilt whatever their mtimes
+    digest = hashlib.sha1()
+    for name in sources:
+        f = open(name, 'rb')
+        digest.update(f.read())
+        f.close()
+    digest.update((o_command + '\n' + so_command + '\n').encode('utf-8'))
+    digest_file = os.path.join(cache_dir, file_prefix + '.sha1')
+    if write_if_changed(digest_file, digest.hexdigest() + '\n'):
+        for name in [objfile, outfile]:
+            if os.path.exists(name):
+                os.remove(name)
+
+    mk.write('%s: %s\n' %(objfile, ' '.join([digest_file] + [header for header in headers if header.endswith('.gch')])))
+    mk.write('\t%s\n\n' %(o_command))
+    mk.write('%s: %s %s\n' %(outfile, ' '.join([objfile] + so_deps), digest_file))
+    mk.write('\t%s\n\n' %(so_command))
+
+#check whether CC can build a precompiled header of lang
+def pch_supported(CC, lang='c'):
+    if CC.find('xl') != -1 or CC.find('clang') != -1:
+        return False
+    probe = os.path.join(cache_dir, 'pch_probe.h')
+    write_if_changed(probe, 'int pynamic_pch_probe;\n')
+    devnull = open(os.devnull, 'w')
+    ret = call('%s -g -fPIC -x %s-header -o %s.gch %s' %(CC, lang, probe, probe), shell=True, stdout=devnull, stderr=devnull)
+    devnull.close()
+    if os.path.exists(probe + '.gch'):
+        os.remove(probe + '.gch')
+    return ret == 0
+
+#write pynamic_pch.h and the Makefile rule that precompiles it
+def compile_pch(mk, num_utility_files, include_dir, CC, lang='c', debug='-g'):
+    #include the utility headers directly rather than pynamic.h, whose init
+    #prototypes change with the module count and would invalidate the PCH
+    text = '#include <Python.h>\n'
+    if num_utility_files > 0:
+        text += '#include <math.h>\n'
+        for i in range(num_utility_files):
+            text += '#include "libutility%d.h"\n' %(i)
+    headers = ['libutility%d.h' %(i) for i in range(num_utility_files)]
+    if lang == 'c++':
+        text += '#include "%s"\n' %(cxx_header_name)
+        headers.append(cxx_header_name)
+    write_if_changed(pch_header_name, text)
+
+    outfile = pch_header_name + '.gch'
+    command = '%s %s -fPIC -x %s-header -o %s %s -I%s' %(CC, debug, lang, outfile, pch_header_name, include_dir)
+    cmd_file = os.path.join(cache_dir, pch_header_name + '.cmd')
+    write_if_changed(cmd_file, command + '\n')
+    mk.write('%s: %s %s\n' %(outfile, ' '.join([pch_header_name] + headers), cmd_file))
+    mk.write('\t%s\n\n' %(command))
+
+#write the Makefile rule that builds the LD_AUDIT library
+def compile_audit(mk, CC):
+    outfile = audit_name + '.so'
+    command = '%s -g -O2 -fPIC -shared -o %s %s.c' %(CC, outfile, audit_name)
+    cmd_file = os.path.join(cache_dir, audit_name + '.cmd')
+    write_if_changed(cmd_file, command + '\n')
+    mk.write('%s: %s.c %s\n' %(outfile, audit_name, cmd_file))
+    mk.write('\t%s\n\n' %(command))
+
+#write the Makefile rule that builds the object registering the unwind tables
+#of a module linked with --no-eh-frame-hdr, without unwind tables of its own
+def compile_eh_frame(mk, CC):
+    outfile = eh_frame_name + '.o'
+    command = '%s -O2 -fPIC -fno-asynchronous-unwind-tables -fno-exceptions -c -o %s %s.c' %(CC, outfile, eh_frame_name)
+    cmd_file = os.path.join(cache_dir, eh_frame_name + '.cmd')
+    write_if_changed(cmd_file, command + '\n')
+    mk.write('%s: %s.c %s\n' %(outfile, eh_frame_name, cmd_file))
+    mk.write('\t%s\n\n' %(command))
+
+#write the Makefile rule that builds the Python-free dlopen harness
+def compile_dlopen(mk, CC):
+    command = '%s -g -O2 -o %s %s.c -ldl' %(CC, dlopen_name, dlopen_name)
+    cmd_file = os.path.join(cache_dir, dlopen_name + '.cmd')
+    write_if_changed(cmd_file, command + '\n')
+    mk.write('%s: %s.c %s\n' %(dlopen_name, dlopen_name, cmd_file))
+    mk.write('\t%s\n\n' %(command))
+
+#write the manifest pynamic_dlopen replays: the libraries in the order they
+#were generated, the functions of each and the entry function of each module.
+#The modules reference the Python C API, so the Python library is loaded
+#first when it is a shared library.  Modules calling each other without
+#DT_NEEDED entries, as -e alone builds them, need RTLD_GLOBAL
+def write_dlopen_manifest(utility_symbols, module_symbols, global_scope=False):
+    text = '# generated by so_generator.py, see pynamic_dlopen.c\n'
+    if global_scope:
+        text += 'scope global\n'
+    libpython = None
+    if get_config_var('Py_ENABLE_SHARED'):
+        libpython = os.path.join(get_config_var('LIBDIR'), get_config_var('LDLIBRARY'))
+    if libpython != None and os.path.exists(libpython):
+        text += 'preload %s\n' %(libpython)
+    for i in range(len(utility_symbols)):
+        text += 'library ./libutility%d.so\n' %(i)
+        text += ''.join(['symbol %s\n' %(name) for name in utility_symbols[i]])
+    for i in range(len(module_symbols)):
+        text += 'library ./libmodule%d.so\n' %(i)
+        text += ''.join(['symbol %s\n' %(name) for name in module_symbols[i]])
+        text += 'entry libmodule%d_centry\n' %(i)
+    write_if_changed(dlopen_name + '.manifest', text)
+
+#write the driver code that imports every module.  When guarded, a module
+#that fails to load is recorded in load_failures and set to None
+def write_imports(f, num_files, guarded):
+    names = ['libmodulebegin'] + ['libmodule' + str(i) for i in range(num_files)] + ['libmodulefinal']
+    for name in names:
+        if guarded:
+            f.write(name + ' = pynamic_import("' + name + '")\n')
+        else:
+            f.write('import ' + name + '\n')
+
+#write the driver code that calls every module's entry function
+def write_visits(f, num_files, guarded):
+    guard = ''
+    if guarded:
+        guard = 'if libmodulebegin: '
+    f.write(guard + 'libmodulebegin.begin_break_here()\n')
+    for i in range(num_files):
+        if guarded:
+            guard = 'if libmodule' + str(i) + ': '
+        f.write(guard + 'libmodule' + str(i) + '.libmodule' + str(i) + '_entry()\n')
+    if guarded:
+        guard = 'if libmodulefinal: '
+    f.write(guard + 'libmodulefinal.break_here()\n')
 
 #create a python driver file
-def create_driver(num_files, filename, mpi_wrapper_text):
+def create_driver(num_files, filename, mpi_wrapper_text, driver_info=[], num_tls=0, path_dirs=(0, 0), num_py_modules=0, unwind_chain=0, eh_chain=0):
     f = open(filename, "w")
     text = """import sys, os
 import time
+import math
+import socket
 end_time = time.time()
 start_time = 0
 mpi_avail = True
+#the repeated import runs of PYNAMIC_CACHE_RUNS are separate processes
+#without MPI
+cache_child = os.environ.get('PYNAMIC_CACHE_CHILD') != None
 try:
+    if cache_child:
+        raise ImportError('no MPI in a cache run')
 """
     text += mpi_wrapper_text
     text += """    mpi = mpi_wrapper()
@@ -259,57 +983,458 @@ except:
             self.procs = 1
         def barrier(self):
             pass
+        def gather(self, obj, destination):
+            return [obj]
+        def bcast(self, obj, root):
+            return obj
     mpi = dummy_mpi()
     mpi_avail = False
 
 mpi.barrier()
 myRank = mpi.rank
 nProcs = mpi.procs
+myHost = socket.gethostname()
+slowest_ranks = int(os.environ.get('PYNAMIC_SLOWEST_RANKS', '5'))
+startup_time = None
+if len(sys.argv) > 1:
+    start_time = float(sys.argv[1])
+    startup_time = end_time - start_time
+
+#every rank times every phase, rank 0 reduces the gathered values
+def pynamic_percentile(ordered, fraction):
+    return ordered[max(0, int(math.ceil(fraction * len(ordered))) - 1)]
+
+def pynamic_stats(name, values, hosts, unit='secs'):
+    ordered = sorted(values)
+    print('Pynamic: %s (%s) min %.6f max %.6f mean %.6f median %.6f p95 %.6f p99 %.6f' %(name, unit,
+          ordered[0], ordered[-1], float(sum(ordered)) / len(ordered), pynamic_percentile(ordered, 0.5),
+          pynamic_percentile(ordered, 0.95), pynamic_percentile(ordered, 0.99)))
+    slowest = sorted(range(len(values)), key=lambda rank: -values[rank])[:slowest_ranks]
+    print('Pynamic: %s slowest ranks: %s' %(name, ', '.join(['%d on %s (%.6f)' %(rank, hosts[rank], values[rank]) for rank in slowest])))
+
+#with PYNAMIC_RANK_TABLE set, write the per rank values to that file, or to
+#stdout when it is -
+rank_tables = []
+def pynamic_rank_table(title, columns, rows):
+    table = os.environ.get('PYNAMIC_RANK_TABLE')
+    if not table:
+        return
+    if table == '-':
+        out = sys.stdout
+    elif len(rank_tables) == 0:
+        out = open(table, 'w')
+    else:
+        out = open(table, 'a')
+    rank_tables.append(title)
+    out.write('Pynamic: per rank %s\\n' %(title))
+    out.write('Pynamic: %6s %s\\n' %('rank', ' '.join(['%14s' %(column) for column in columns])))
+    for rank in range(len(rows)):
+        cells = []
+        for value in rows[rank]:
+            if isinstance(value, float):
+                cells.append('%14.6f' %(value))
+            else:
+                cells.append('%14s' %(value))
+        out.write('Pynamic: %6d %s\\n' %(rank, ' '.join(cells)))
+    if out != sys.stdout:
+        out.close()
+
+#PYNAMIC_CACHE_MODE=cold drops the generated libraries and .pyc files from
+#the page cache before the import, warm reads them in first.  Each rank
+#then repeats the import and visit PYNAMIC_CACHE_RUNS times in new processes
+cache_mode = os.environ.get('PYNAMIC_CACHE_MODE')
+cache_runs = 0
+if cache_mode != None and not cache_child:
+    cache_runs = int(os.environ.get('PYNAMIC_CACHE_RUNS', '3'))
+if cache_mode not in [None, 'cold', 'warm']:
+    if myRank == 0:
+        print('Pynamic: unknown PYNAMIC_CACHE_MODE %s, use cold or warm' %(cache_mode))
+    sys.exit(-1)
+
+def pynamic_cache_files():
+    pynamic_dir = os.path.dirname(os.path.abspath(__file__))
+    files = [os.path.join(pynamic_dir, name) for name in os.listdir(pynamic_dir)
+             if name.startswith('lib') and (name.endswith('.so') or name.find('.so.') != -1)
+             or name.startswith('""" + py_module_prefix + """') and name.endswith('.py')]
+    for sub_dir in ['__pycache__', '""" + path_dir + """']:
+        for root, dirs, names in os.walk(os.path.join(pynamic_dir, sub_dir)):
+            files += [os.path.join(root, name) for name in names if name.endswith('.so') or name.endswith('.pyc')]
+    return files
+
+def pynamic_fadvise(fd):
+    try:
+        os.posix_fadvise(fd, 0, 0, os.POSIX_FADV_DONTNEED)
+    except AttributeError:
+        #python 2 has no os.posix_fadvise, 4 is POSIX_FADV_DONTNEED on Linux
+        import ctypes
+        if ctypes.CDLL(None).posix_fadvise(fd, ctypes.c_long(0), ctypes.c_long(0), 4) != 0:
+            raise OSError('posix_fadvise failed')
+
+#dirty pages are not dropped, so write them back first
+def pynamic_evict(files):
+    evicted = 0
+    for name in files:
+        try:
+            fd = os.open(name, os.O_RDONLY)
+        except OSError:
+            continue
+        try:
+            try:
+                os.fdatasync(fd)
+            except OSError:
+                pass
+            pynamic_fadvise(fd)
+            evicted += 1
+        except OSError:
+            pass
+        os.close(fd)
+    return evicted
+
+def pynamic_warm(files):
+    for name in files:
+        try:
+            f = open(name, 'rb')
+            while f.read(1 << 20):
+                pass
+            f.close()
+        except IOError:
+            pass
+    return len(files)
+
+#one import and visit in a new process without the environment variables
+#in unset, returns (import, visit, Python module import) or None
+def pynamic_cache_run(unset=[]):
+    import subprocess
+    env = dict([(name, os.environ[name]) for name in os.environ if name not in unset])
+    env['PYNAMIC_CACHE_CHILD'] = '1'
+    try:
+        p = subprocess.Popen([sys.executable, os.path.abspath(__file__)], env=env,
+                             stdout=subprocess.PIPE, universal_newlines=True)
+        out = p.communicate()[0]
+    except OSError:
+        return None
+    for line in out.splitlines():
+        if line.startswith('pynamic_cache_run '):
+            return tuple([float(value) for value in line.split()[1:4]])
+    return None
+
 if myRank == 0:
     print('Pynamic: Version 1.3.3')
     print('Pynamic: run on %s with %s MPI tasks\\n' %(time.strftime("%x %X"), nProcs))
-    if len(sys.argv) > 1:
-        start_time = float(sys.argv[1])
-        print('Pynamic: startup time = ' + str(end_time - start_time) + ' secs')
+"""
+    #describe how the modules were built
+    for info in driver_info:
+        text += "    print('Pynamic: %s')\n" %(info)
+    text += """    if os.environ.get('LD_BIND_NOW'):
+        print('Pynamic: LD_BIND_NOW is set, all symbols are bound at load time')
+    if os.environ.get('LD_AUDIT'):
+        print('Pynamic: LD_AUDIT = ' + os.environ['LD_AUDIT'])
+    if cache_mode != None:
+        print('Pynamic: page cache mode = %s, %d repeated runs' %(cache_mode, cache_runs))
+    if os.environ.get('PYNAMIC_BCAST_IMPORT'):
+        print('Pynamic: PYNAMIC_BCAST_IMPORT is set, modules are broadcast from rank 0')
+    if os.environ.get('PYNAMIC_BCAST_SOURCE'):
+        print('Pynamic: PYNAMIC_BCAST_SOURCE is set, Python code is broadcast from rank 0')
     print('Pynamic: driver beginning... now importing modules')
 
-    import_start = time.time()
+#rank 0 reads the libraries and broadcasts them to the other ranks
+bcast_import = os.environ.get('PYNAMIC_BCAST_IMPORT') != None
+if bcast_import:
+    import pynamic_bcast
+    bcast_finder = pynamic_bcast.install(mpi, os.path.dirname(os.path.abspath(__file__)))
+#mpi4py_main installs the source hook before it imports the driver
+bcast_source = os.environ.get('PYNAMIC_BCAST_SOURCE') != None
+if bcast_source:
+    import pynamic_bcast
+    source_finder = pynamic_bcast.install_source(mpi)
+    bcast_source = source_finder != None
+
 """
     f.write(text)
 
-    f.write('import libmodulebegin\n')
-    for i in range(num_files):
-        f.write('import libmodule' + str(i) + '\n')
-    f.write('import libmodulefinal\n')
+    #dlopen'ing many modules with thread-local storage can run out of static
+    #TLS space, so count those failures instead of stopping at the first one
+    guarded = num_tls > 0
+    if guarded:
+        text = """load_failures = []
+def pynamic_import(name):
+    try:
+        return __import__(name)
+    except ImportError:
+        load_failures.append((name, str(sys.exc_info()[1])))
+        return None
+
+"""
+        f.write(text)
+
+    #search the decoy directories and then the package directories for the
+    #modules, counting the stat and listdir calls of the import system
+    num_pkg_dirs, num_decoy_dirs = path_dirs
+    count_lookups = num_pkg_dirs > 0 or num_decoy_dirs > 0
+    if count_lookups:
+        text = """pynamic_dir = os.path.dirname(os.path.abspath(__file__))
+path_dirs = [os.path.join(pynamic_dir, '%s', 'decoy%%d' %%(k)) for k in range(%d)]
+path_dirs += [os.path.join(pynamic_dir, '%s', 'pkg%%d' %%(k)) for k in range(%d)]
+if %d > 0:
+    sys.path = [p for p in sys.path if os.path.abspath(p or '.') != pynamic_dir]
+sys.path = path_dirs + sys.path
+
+fs_lookups = {'stat': 0, 'listdir': 0}
+def count_lookups(name, function):
+    def counted(*args, **kwargs):
+        fs_lookups[name] += 1
+        return function(*args, **kwargs)
+    return counted
+try:
+    import posix
+    posix.stat = count_lookups('stat', posix.stat)
+    posix.listdir = count_lookups('listdir', posix.listdir)
+except ImportError:
+    pass
+
+""" %(path_dir, num_decoy_dirs, path_dir, num_pkg_dirs, num_pkg_dirs)
+        f.write(text)
+
+    #every rank of a node touches the same files, which is harmless
+    text = """if cache_mode == 'cold':
+    cache_files = pynamic_evict(pynamic_cache_files())
+elif cache_mode == 'warm':
+    cache_files = pynamic_warm(pynamic_cache_files())
+if cache_mode != None and myRank == 0:
+    print('Pynamic: %s page cache for %d files' %(cache_mode == 'cold' and 'dropped the' or 'read into the', cache_files))
+mpi.barrier()
+import_start = time.time()
+"""
+    f.write(text)
+    write_imports(f, num_files, guarded)
+
+    #every rank times its own phases, the first visit binds the lazily
+    #bound symbols and the second one only calls through resolved entries
+    text = """import_time = time.time() - import_start
+"""
+    f.write(text)
+
+    #the pure Python modules are timed on their own
+    if num_py_modules > 0:
+        f.write('py_import_start = time.time()\n')
+        for i in range(num_py_modules):
+            f.write('import %s%d\n' %(py_module_prefix, i))
+        f.write('py_import_time = time.time() - py_import_start\n')
 
     text = """mpi.barrier()
 if myRank == 0:
-    import_end = time.time()
-    import_time = import_end - import_start
     print('Pynamic: driver finished importing all modules... visiting all module functions')
 
-    call_start = time.time()
+mpi.barrier()
+call_start = time.time()
 """
     f.write(text)
+    write_visits(f, num_files, guarded)
 
-    f.write('libmodulebegin.begin_break_here()\n')
-    for i in range(num_files):
-        f.write('libmodule' + str(i) + '.libmodule' + str(i) + '_entry()\n')
-    f.write('libmodulefinal.break_here()\n')
+    text = """call_time = time.time() - call_start
+"""
+    if num_py_modules > 0:
+        text += 'py_call_start = time.time()\n'
+        for i in range(num_py_modules):
+            text += '%s%d.%s%d_entry()\n' %(py_module_prefix, i, py_module_prefix, i)
+        text += 'py_call_time = time.time() - py_call_start\n'
+    text += """call2_start = time.time()
+"""
+    f.write(text)
+    write_visits(f, num_files, guarded)
 
-    text = """mpi.barrier()
+    text = """call2_time = time.time() - call2_start
+if cache_child:
+    print('pynamic_cache_run %r %r %r' %(import_time, call_time, globals().get('py_import_time', -1.0)))
+    sys.exit(0)
+mpi.barrier()
+rank_times = mpi.gather((myHost, startup_time, import_time, call_time, call2_time), 0)
+if myRank == 0:
+    hosts = [t[0] for t in rank_times]
+    if startup_time != None:
+        print('Pynamic: startup time = ' + str(max([t[1] for t in rank_times])) + ' secs')
+    print('Pynamic: module import time = ' + str(max([t[2] for t in rank_times])) + ' secs')
+    print('Pynamic: module visit time = ' + str(max([t[3] for t in rank_times])) + ' secs')
+    print('Pynamic: module second visit time = ' + str(max([t[4] for t in rank_times])) + ' secs')
+    if startup_time != None:
+        pynamic_stats('startup time', [t[1] for t in rank_times], hosts)
+    pynamic_stats('import time', [t[2] for t in rank_times], hosts)
+    pynamic_stats('visit time', [t[3] for t in rank_times], hosts)
+    pynamic_stats('second visit time', [t[4] for t in rank_times], hosts)
+    pynamic_rank_table('times in secs', ['host', 'startup', 'import', 'visit', 'second visit'], rank_times)
+"""
+    f.write(text)
+
+    if num_py_modules > 0:
+        text = """rank_py = mpi.gather((py_import_time, py_call_time), 0)
 if myRank == 0:
-    call_end = time.time()
-    call_time = call_end - call_start
-    print('Pynamic: module import time = ' + str(import_time) + ' secs')
-    print('Pynamic: module visit time = ' + str(call_time) + ' secs')
+    print('Pynamic: Python module import time = ' + str(max([t[0] for t in rank_py])) + ' secs for %d modules')
+    print('Pynamic: Python module visit time = ' + str(max([t[1] for t in rank_py])) + ' secs')
+    pynamic_stats('Python import time', [t[0] for t in rank_py], hosts)
+    pynamic_stats('Python visit time', [t[1] for t in rank_py], hosts)
+    pynamic_rank_table('Python module times in secs', ['import', 'visit'], rank_py)
+""" %(num_py_modules)
+        f.write(text)
+
+    text = """#compare against one import from the file system in a new process
+if (bcast_import or bcast_source) and not cache_child:
+    fs_run = pynamic_cache_run(['PYNAMIC_BCAST_IMPORT', 'PYNAMIC_BCAST_SOURCE']) or (-1.0, -1.0, -1.0)
+    rank_bcast = mpi.gather((import_time, fs_run[0], globals().get('py_import_time', -1.0), fs_run[2]), 0)
+    #mpi4py_main installs the source hook before it imports the driver
+    driver_import_time = -1.0
+    if bcast_source and source_finder.install_time < end_time:
+        driver_import_time = end_time - source_finder.install_time
+    rank_driver = mpi.gather(driver_import_time, 0)
+    if bcast_import:
+        rank_libraries = mpi.gather((bcast_finder.libraries, bcast_finder.bytes, bcast_finder.bcast_time, bcast_finder.load_time), 0)
+    if bcast_source:
+        rank_source = mpi.gather((source_finder.modules, source_finder.bytecode, source_finder.cache_hits, source_finder.bytes, source_finder.bcast_time, source_finder.load_time), 0)
+    if myRank == 0:
+        if bcast_import:
+            print('Pynamic: broadcast %d libraries, %d bytes, bcast time = %s secs, memfd load time = %s secs' %(max([t[0] for t in rank_libraries]), max([t[1] for t in rank_libraries]), max([t[2] for t in rank_libraries]), max([t[3] for t in rank_libraries])))
+            pynamic_stats('library bcast time', [t[2] for t in rank_libraries], hosts)
+        if bcast_source:
+            print('Pynamic: broadcast %d Python modules (%d from .pyc, %d cached), %d bytes, bcast time = %s secs, unmarshal time = %s secs' %(max([t[0] for t in rank_source]), max([t[1] for t in rank_source]), max([t[2] for t in rank_source]), max([t[3] for t in rank_source]), max([t[4] for t in rank_source]), max([t[5] for t in rank_source])))
+            pynamic_stats('source bcast time', [t[4] for t in rank_source], hosts)
+        #each broadcast only changes its own phase of the import, and a
+        #comparison run that failed reports -1.0
+        fs_failed = len([t for t in rank_bcast if t[1] < 0])
+        if fs_failed > 0:
+            print('Pynamic: the file system import run failed on %d ranks, no comparison' %(fs_failed))
+        elif bcast_import:
+            bcast_max = max([t[0] for t in rank_bcast])
+            fs_max = max([t[1] for t in rank_bcast])
+            print('Pynamic: broadcast import time = %s secs, file system import time = %s secs, difference = %s secs' %(bcast_max, fs_max, fs_max - bcast_max))
+            pynamic_stats('file system import time', [t[1] for t in rank_bcast], hosts)
+        if fs_failed == 0 and bcast_source and min([t[2] for t in rank_bcast]) >= 0:
+            bcast_max = max([t[2] for t in rank_bcast])
+            fs_max = max([t[3] for t in rank_bcast])
+            print('Pynamic: broadcast Python module import time = %s secs, file system Python module import time = %s secs, difference = %s secs' %(bcast_max, fs_max, fs_max - bcast_max))
+            pynamic_stats('file system Python module import time', [t[3] for t in rank_bcast], hosts)
+        if min(rank_driver) >= 0:
+            print('Pynamic: broadcast driver import time = %s secs' %(max(rank_driver)))
+            pynamic_stats('broadcast driver import time', rank_driver, hosts)
+        pynamic_rank_table('broadcast import times in secs', ['bcast import', 'fs import', 'bcast Python', 'fs Python'], rank_bcast)
+
+#the first repeated run is warm, the median of the others is the steady state.
+#Without PYNAMIC_CACHE_MODE the runs leave the page cache as it is
+if cache_runs > 0:
+    runs = [pynamic_cache_run(['PYNAMIC_CACHE_MODE']) for run in range(cache_runs)]
+    runs = [run for run in runs if run != None]
+    if len(runs) == 0:
+        runs = [(-1.0, -1.0)]
+    steady = sorted(runs[1:] or runs)
+    steady = steady[(len(steady) - 1) // 2]
+    rank_cache = mpi.gather((import_time, call_time, runs[0][0], runs[0][1], steady[0], steady[1], len(runs)), 0)
+    if myRank == 0:
+        print('Pynamic: %s first import time = %s secs, visit time = %s secs' %(cache_mode, max([t[0] for t in rank_cache]), max([t[1] for t in rank_cache])))
+        print('Pynamic: warm repeat import time = %s secs, visit time = %s secs' %(max([t[2] for t in rank_cache]), max([t[3] for t in rank_cache])))
+        print('Pynamic: steady-state import time = %s secs, visit time = %s secs (%d runs)' %(max([t[4] for t in rank_cache]), max([t[5] for t in rank_cache]), min([t[6] for t in rank_cache])))
+        pynamic_stats(cache_mode + ' first import time', [t[0] for t in rank_cache], hosts)
+        pynamic_stats('warm repeat import time', [t[2] for t in rank_cache], hosts)
+        pynamic_stats('steady-state import time', [t[4] for t in rank_cache], hosts)
+        pynamic_rank_table('page cache times in secs', ['first import', 'first visit', 'repeat import', 'repeat visit', 'steady import', 'steady visit', 'runs'], rank_cache)
+"""
+    f.write(text)
+
+    if count_lookups:
+        text = """rank_lookups = mpi.gather((import_time, fs_lookups['stat'], fs_lookups['listdir']), 0)
+if myRank == 0:
+    print('Pynamic: import searched %d decoy and %d package directories')
+    print('Pynamic: filesystem lookups during import = %%d stat, %%d listdir (max per rank), %%d total' %%(max([t[1] for t in rank_lookups]), max([t[2] for t in rank_lookups]), sum([t[1] + t[2] for t in rank_lookups])))
+    pynamic_stats('import stat calls', [t[1] for t in rank_lookups], hosts, 'calls')
+    pynamic_stats('import listdir calls', [t[2] for t in rank_lookups], hosts, 'calls')
+    pynamic_rank_table('import lookups', ['import secs', 'stat', 'listdir'], rank_lookups)
+""" %(num_decoy_dirs, num_pkg_dirs)
+        f.write(text)
+
+    if num_tls > 0:
+        text = """
+mpi.barrier()
+tls_start = time.time()
+"""
+        f.write(text)
+        for i in range(num_files):
+            f.write('if libmodule%d: libmodule%d.libmodule%d_tls_entry(%d)\n' %(i, i, i, tls_iterations))
+        text = """tls_time = time.time() - tls_start
+tls_loaded = len([name for name in sys.modules if name.startswith('libmodule') and name[9:].isdigit()])
+rank_tls = mpi.gather((load_failures, tls_loaded, tls_time), 0)
+if myRank == 0:
+    failures = [failure for t in rank_tls for failure in t[0]]
+    print('Pynamic: %%d module loads failed across %%d ranks' %%(len(failures), len([t for t in rank_tls if len(t[0]) > 0])))
+    if len(failures) > 0:
+        print('Pynamic: first load failure: %%s: %%s' %%(failures[0][0], failures[0][1]))
+    slowest = max(rank_tls, key=lambda t: t[2])
+    accesses = max(1, slowest[1] * %d * %d)
+    print('Pynamic: TLS access time = %%s secs for %%d modules, %%.2f ns per access' %%(slowest[2], slowest[1], slowest[2] * 1e9 / accesses))
+    pynamic_stats('TLS access time', [t[2] for t in rank_tls], hosts)
+""" %(num_tls, tls_iterations)
+        f.write(text)
+
+    if unwind_chain > 0:
+        text = """
+#call the hops of %d modules, each in the next one, and time the backtrace
+#of the last hop.  The first backtrace also loads the unwinder
+unwind_chain = []
+for i in range(%d):
+    module = globals().get('libmodule%%d' %%(i %% %d))
+    if module:
+        unwind_chain.append(getattr(module, 'libmodule%%d_hop_address' %%(i %% %d))())
+unwind_runs = []
+if libmodulebegin and len(unwind_chain) > 0:
+    unwind_runs = [libmodulebegin.unwind_chain(unwind_chain) for run in range(%d)]
+if len(unwind_runs) == 0:
+    unwind_runs = [(-1.0, 0)]
+unwind_steady = sorted([run[0] for run in unwind_runs[1:] or unwind_runs])
+unwind_steady = unwind_steady[(len(unwind_steady) - 1) // 2]
+rank_unwind = mpi.gather((unwind_runs[0][0], unwind_steady, unwind_runs[0][1], len(unwind_chain)), 0)
+if myRank == 0:
+    print('Pynamic: unwind chain across %%d modules, %%d frames' %%(min([t[3] for t in rank_unwind]), max([t[2] for t in rank_unwind])))
+    print('Pynamic: first backtrace time = %%s secs, steady-state backtrace time = %%s secs' %%(max([t[0] for t in rank_unwind]), max([t[1] for t in rank_unwind])))
+    pynamic_stats('first backtrace time', [t[0] for t in rank_unwind], hosts)
+    pynamic_stats('steady-state backtrace time', [t[1] for t in rank_unwind], hosts)
+    pynamic_rank_table('backtrace times in secs', ['first', 'steady state', 'frames', 'hops'], rank_unwind)
+""" %(unwind_chain, unwind_chain, num_files, num_files, unwind_runs)
+        f.write(text)
+
+    if eh_chain > 0:
+        text = """
+#throw an exception from the last of the hops of %d modules and catch it in
+#the first one, and time the throw to the catch.  The first throw also loads
+#the unwinder and the unwind tables of the modules
+eh_chain = []
+if globals().get('libmodule0'):
+    eh_chain.append(libmodule0.libmodule0_eh_catch_address())
+    for i in range(1, %d):
+        module = globals().get('libmodule%%d' %%(i %% %d))
+        if module:
+            eh_chain.append(getattr(module, 'libmodule%%d_eh_hop_address' %%(i %% %d))())
+eh_runs = []
+if libmodulebegin and len(eh_chain) > 0:
+    eh_runs = [libmodulebegin.unwind_chain(eh_chain) for run in range(%d)]
+if len(eh_runs) == 0:
+    eh_runs = [(-1.0, 0)]
+eh_steady = sorted([run[0] for run in eh_runs[1:] or eh_runs])
+eh_steady = eh_steady[(len(eh_steady) - 1) // 2]
+rank_eh = mpi.gather((eh_runs[0][0], eh_steady, len(eh_chain)), 0)
+if myRank == 0:
+    print('Pynamic: exception chain across %%d modules' %%(min([t[2] for t in rank_eh])))
+    print('Pynamic: first throw-to-catch time = %%s secs, steady-state throw-to-catch time = %%s secs' %%(max([t[0] for t in rank_eh]), max([t[1] for t in rank_eh])))
+    pynamic_stats('first throw-to-catch time', [t[0] for t in rank_eh], hosts)
+    pynamic_stats('steady-state throw-to-catch time', [t[1] for t in rank_eh], hosts)
+    pynamic_rank_table('throw-to-catch times in secs', ['first', 'steady state', 'modules'], rank_eh)
+""" %(eh_chain, eh_chain, num_files, num_files, unwind_runs)
+        f.write(text)
+
+    text = """if myRank == 0:
     print('Pynamic: module test passed!\\n')
 if mpi_avail == False:
     sys.exit(0)
 
 if myRank == 0:
     print('Pynamic: testing mpi capability...\\n')
-    mpi_start = time.time()
+mpi.barrier()
+mpi_start = time.time()
 """
     f.write(text)
 
@@ -320,102 +1445,556 @@ if myRank == 0:
         if line.find('message') == -1: #suppress each task printing
             f.write(line)
 
-    text = """mpi.barrier()
+    text = """mpi_time = time.time() - mpi_start
+mpi.barrier()
+rank_mpi = mpi.gather((myHost, mpi_time), 0)
 if myRank == 0:
-    mpi_end = time.time()
-    print('\\nPynamic: fractal mpi time = ' + str(mpi_end - mpi_start) + ' secs')
+    print('\\nPynamic: fractal mpi time = ' + str(max([t[1] for t in rank_mpi])) + ' secs')
+    pynamic_stats('fractal mpi time', [t[1] for t in rank_mpi], [t[0] for t in rank_mpi])
+    pynamic_rank_table('fractal mpi time in secs', ['host', 'fractal'], rank_mpi)
     print('Pynamic: mpi test passed!\\n')
 """
     f.write(text)
 
     f.close()
 
+#hard link the built modules into num_pkg_dirs directories, module i in
+#directory i % num_pkg_dirs, and create num_decoy_dirs directories holding
+#only unrelated files for the driver to search first
+def create_path_dirs(num_modules, num_pkg_dirs, num_decoy_dirs, num_py_modules=0):
+    #the linker replaces a rebuilt library, so links from a previous run
+    #would point to the old one
+    if os.path.isdir(path_dir):
+        shutil.rmtree(path_dir)
+    if num_pkg_dirs == 0 and num_decoy_dirs == 0:
+        return
+    os.mkdir(path_dir)
+    for k in range(num_decoy_dirs):
+        decoy = os.path.join(path_dir, 'decoy%d' %(k))
+        os.mkdir(decoy)
+        for j in range(decoy_files):
+            f = open(os.path.join(decoy, 'decoy%d_%d.py' %(k, j)), 'w')
+            f.close()
+    for k in range(num_pkg_dirs):
+        os.mkdir(os.path.join(path_dir, 'pkg%d' %(k)))
+    if num_pkg_dirs > 0:
+        #a copy would be loaded a second time next to the library the other
+        #modules need, so fall back to a symlink to the same file
+        names = ['libmodulebegin'] + ['libmodule%d' %(i) for i in range(num_modules)] + ['libmodulefinal']
+        num_symlinks = 0
+        for i in range(len(names)):
+            target = os.path.join(path_dir, 'pkg%d' %(i % num_pkg_dirs), names[i] + '.so')
+            try:
+                os.link(names[i] + '.so', target)
+            except OSError:
+                os.symlink(os.path.abspath(names[i] + '.so'), target)
+                num_symlinks += 1
+        if num_symlinks > 0:
+            print('Pynamic: hard links failed, %d modules in %s are symlinks' %(num_symlinks, path_dir))
+        for i in range(num_py_modules):
+            source = '%s%d.py' %(py_module_prefix, i)
+            target = os.path.join(path_dir, 'pkg%d' %(i % num_pkg_dirs), source)
+            shutil.copy2(source, target)
+            compileall.compile_file(target, quiet=1)
+    print('Pynamic: %d package and %d decoy directories in %s' %(num_pkg_dirs, num_decoy_dirs, path_dir))
+
+#parse --py-modules=<num_modules>[:<functions>,<classes>,<imports>,<statements>]
+def parse_py_modules(text):
+    fields = text.split(':')
+    if len(fields) > 2:
+        raise ValueError('invalid --py-modules %s' %(text))
+    params = [int(fields[0])] + list(py_module_defaults)
+    if len(fields) == 2:
+        values = fields[1].split(',')
+        if len(values) > len(py_module_defaults):
+            raise ValueError('too many parameters for --py-modules %s' %(text))
+        for i in range(len(values)):
+            params[i + 1] = int(values[i])
+    return tuple(params)
+
+#write one statement working on the locals v0 to v3 of a function
+def write_py_statement(f, rng, indent, name):
+    dest = rng.randrange(4)
+    src = (dest + rng.randint(1, 3)) % 4
+    kind = rng.randrange(5)
+    if kind == 0:
+        f.write('%sv%d = (v%d * %d + v%d) %% %d\n' %(indent, dest, src, rng.randint(2, 97), rng.randrange(4), rng.randint(1000, 100000)))
+    elif kind == 1:
+        f.write('%sif v%d > v%d:\n' %(indent, dest, src))
+        f.write('%s    v%d = v%d - %d\n' %(indent, dest, dest, rng.randint(1, 50)))
+        f.write('%selse:\n' %(indent))
+        f.write('%s    v%d = v%d + %d\n' %(indent, src, dest, rng.randint(1, 50)))
+    elif kind == 2:
+        f.write('%sfor k in range(%d):\n' %(indent, rng.randint(2, 5)))
+        f.write('%s    v%d = v%d + k * %d\n' %(indent, dest, dest, rng.randint(1, 9)))
+    elif kind == 3:
+        f.write("%sv%d = v%d + len('%s_%d_' + str(v%d))\n" %(indent, dest, dest, name, rng.randint(0, 1 << 20), src))
+    else:
+        f.write('%sv%d = v%d + len((%d, %d, %d))\n' %(indent, dest, src, rng.randint(0, 1000), rng.randint(0, 1000), rng.randint(0, 1000)))
+
+def write_py_body(f, rng, indent, name, num_statements):
+    f.write('%sv0 = a\n%sv1 = %d\n%sv2 = %d\n%sv3 = %d\n' %(indent, indent, rng.randint(1, 100), indent, rng.randint(1, 100), indent, rng.randint(1, 100)))
+    for i in range(rng.randint(1, max(1, 2 * num_statements - 1))):
+        write_py_statement(f, rng, indent, name)
+
+#generate a pure Python module with functions, a class hierarchy and
+#imports of earlier modules.  Only function 0 and the methods of class 0
+#never call into other modules, so the calls can't recurse
+def generate_py_file(my_id, num_functions, num_classes, num_imports, num_statements, seedval):
+    rng = module_random(seedval, py_module_prefix, my_id)
+    name = '%s%d' %(py_module_prefix, my_id)
+    imports = sorted(rng.sample(range(my_id), min(num_imports, my_id)))
+    f = StringIO()
+    f.write('# Generated by so_generator.py, do not edit\n')
+    for i in imports:
+        f.write('import %s%d\n' %(py_module_prefix, i))
+    f.write('\n')
+
+    num_functions = max(1, rng.randint(num_functions // 2, num_functions + num_functions // 2))
+    for j in range(num_functions):
+        f.write('def %s_f%d(a, b):\n' %(name, j))
+        write_py_body(f, rng, '    ', name, num_statements)
+        if j > 0 and len(imports) > 0 and rng.random() < 0.5:
+            other = '%s%d' %(py_module_prefix, rng.choice(imports))
+            f.write('    v0 = v0 + %s.%s_f0(v1, b)\n' %(other, other))
+        f.write('    return v0 + v1 + v2 + v3 + b\n\n')
+
+    classes = []
+    for k in range(num_classes):
+        class_name = 'PynamicPy%dC%d' %(my_id, k)
+        base = None
+        if k > 0 and len(imports) > 0 and rng.random() < 0.3:
+            other = rng.choice(imports)
+            base = '%s%d.PynamicPy%dC0' %(py_module_prefix, other, other)
+        elif k > 0 and rng.random() < 0.7:
+            base = rng.choice(classes)
+        f.write('class %s(%s):\n' %(class_name, base or 'object'))
+        f.write('    kind = %d\n' %(k))
+        f.write('    def __init__(self, x):\n')
+        if base != None:
+            f.write('        %s.__init__(self, x)\n' %(base))
+        f.write('        self.x%d = x + %d\n' %(k, rng.randint(0, 100)))
+        for m in range(rng.randint(1, 3)):
+            f.write('    def m%d(self, a):\n' %(m))
+            write_py_body(f, rng, '        ', name, num_statements)
+            if base != None and m == 0:
+                f.write('        v0 = v0 + %s.m0(self, v1)\n' %(base))
+            f.write('        return v0 + v1 + v2 + v3\n')
+        f.write('\n')
+        classes.append(class_name)
+
+    f.write('def %s_entry():\n' %(name))
+    f.write('    total = 0\n')
+    for j in range(num_functions):
+        f.write('    total = total + %s_f%d(%d, %d)\n' %(name, j, j, j + 1))
+    if len(classes) > 0:
+        f.write('    for cls in (%s,):\n' %(', '.join(classes)))
+        f.write('        total = total + cls(total % 97).m0(total % 89)\n')
+    f.write('    return total\n')
+    write_if_changed(name + '.py', f.getvalue())
+    return num_functions
+
+#generate the --py-modules and compile them, leaving the .pyc files the
+#driver imports
+def create_py_modules(py_modules, seedval):
+    num_modules, num_functions, num_classes, num_imports, num_statements = py_modules
+    total = 0
+    for i in range(num_modules):
+        total += generate_py_file(i, num_functions, num_classes, num_imports, num_statements, seedval)
+        compileall.compile_file('%s%d.py' %(py_module_prefix, i), quiet=1)
+    if num_modules > 0:
+        print('Pynamic: %d Python modules with %d functions and %d classes' %(num_modules, total, num_modules * num_classes))
+
 #create a function list    (type + args quantity and types)
-def create_function_list(num_functions):
+def create_function_list(num_functions, rng):
     functions = []
     for i in range(num_functions):
         function = []
-        function_type = var_types[random.randint(0, len(var_types) - 1)]
+        function_type = var_types[rng.randint(0, len(var_types) - 1)]
         function.append(function_type)
-        num_args = random.randint(0,5)
+        num_args = rng.randint(0,5)
         function.append(num_args)
         for arg_num in range(num_args):
-            type = var_types[random.randint(0, len(var_types) - 1)]
+            type = var_types[rng.randint(0, len(var_types) - 1)]
             function.append(type)
         functions.append(function)
     return functions
 
-#the main driver
-def run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, seedval, num_utility_files, avg_num_u_functions, fun_print, name_length, include_dir, CC, processes):
-
+#remove generated files, keeping the ones the build cache can reuse
+def remove_generated_files(num_modules, num_utility_files, use_cache, num_py_modules=0):
+    if not use_cache and os.path.isdir(cache_dir):
+        for file in os.listdir(cache_dir):
+            os.remove(os.path.join(cache_dir, file))
     for p,d,f in os.walk('./'):
         if p == './':
             for file in f:
+                m = re.match(py_module_prefix + r'(\d+)\.py$', file)
+                if m != None and int(m.group(1)) >= num_py_modules:
+                    os.remove(file)
                 if (file.find('libmodule') != -1 or file.find('libutility') != -1 or file.find('pynamic.h') != -1) and file.find('libmodulefinal.c') == -1 and file.find('libmodulebegin.c') == -1:
+                    if use_cache:
+                        #only remove modules beyond the current configuration
+                        m = re.match(r'lib(module|utility)(\d+)\.', file)
+                        if m == None:
+                            continue
+                        if m.group(1) == 'module':
+                            num = num_modules
+                        else:
+                            num = num_utility_files
+                        if int(m.group(2)) < num:
+                            continue
+                        cache_file = os.path.join(cache_dir, file[:file.find('.')] + '.sha1')
+                        if os.path.exists(cache_file):
+                            os.remove(cache_file)
                     os.remove(file)
 
-    if extern:
-        global extern_list
-        extern_list = create_function_list(num_files)
+#the debug info options of every compile and link command
+def debug_flags(dwarf_version, split_dwarf, compress_debug):
+    if dwarf_version == None:
+        flags = '-g'
+    else:
+        flags = '-gdwarf-%d' %(dwarf_version)
+    if split_dwarf:
+        flags += ' -gsplit-dwarf'
+    if compress_debug != 'none':
+        flags += ' -gz=%s' %(compress_debug)
+    return flags
+
+#the symbol binding models accepted by --symbol-model
+symbol_models = ['default', 'hidden', 'symbolic', 'no-interposition', 'version-script']
+
+#the compile and link flags that build a generated library with symbol_model
+def symbol_model_flags(symbol_model, file_prefix):
+    cflags = ''
+    ldflags = ''
+    link_deps = []
+    if symbol_model == 'hidden':
+        cflags = ' -fvisibility=hidden'
+    elif symbol_model == 'symbolic':
+        ldflags = ' -Wl,-Bsymbolic'
+    elif symbol_model == 'no-interposition':
+        cflags = ' -fno-semantic-interposition'
+    elif symbol_model == 'version-script':
+        ldflags = ' -Wl,--version-script=%s.map' %(file_prefix)
+        link_deps = [file_prefix + '.map']
+    return cflags, ldflags, link_deps
+
+#the binding modes accepted by --bind and their compile and link flags
+bind_modes = {'default': ('', ''), 'lazy': ('', ' -Wl,-z,lazy'), 'now': ('', ' -Wl,-z,now'), 'noplt': (' -fno-plt', '')}
+
+#the compile and link flags of a generated library
+def library_flags(file_prefix, symbol_model, bind_mode):
+    cflags, ldflags, link_deps = symbol_model_flags(symbol_model, file_prefix)
+    cflags += bind_modes[bind_mode][0]
+    ldflags += bind_modes[bind_mode][1]
+    return cflags, ldflags, link_deps
+
+#the topologies accepted by --topology and the default of their parameters
+topologies = {'chain': [], 'tree': [2], 'dag': [0.01], 'powerlaw': [2], 'layered': [4, 2]}
+
+#parse --topology=<type>[:<param>[,<param>]] into a (type, params) tuple
+def parse_topology(text):
+    fields = text.split(':')
+    kind = fields[0]
+    if kind not in topologies or len(fields) > 2:
+        raise ValueError('unknown topology %s' %(text))
+    params = list(topologies[kind])
+    if len(fields) == 2:
+        values = fields[1].split(',')
+        if len(values) > len(params):
+            raise ValueError('too many parameters for topology %s' %(text))
+        for i in range(len(values)):
+            params[i] = type(params[i])(values[i])
+    #the fan-out, degree and layer counts need at least one, the density is
+    #a probability
+    if kind == 'dag':
+        if params[0] < 0.0 or params[0] > 1.0:
+            raise ValueError('the density of topology %s must be between 0 and 1' %(text))
+    elif len([param for param in params if param < 1]) > 0:
+        raise ValueError('the parameters of topology %s must be at least 1' %(text))
+    return (kind, params)
+
+#pick the modules each module depends on.  Dependencies always have a lower
+#id, so the graph is acyclic and module i can be linked after its dependencies
+def create_topology(topology, num_modules, seedval):
+    kind, params = topology
+    rng = module_random(seedval, 'topology', 0)
+    dependencies = []
+    if kind == 'powerlaw':
+        #preferential attachment: a module appears once for itself and once
+        #for every module depending on it
+        targets = []
+    elif kind == 'layered':
+        layers = {}
+    for i in range(num_modules):
+        deps = []
+        if i == 0:
+            pass
+        elif kind == 'chain':
+            deps = [i - 1]
+        elif kind == 'tree':
+            deps = [(i - 1) // params[0]]
+        elif kind == 'dag':
+            #each earlier module is a dependency with probability density,
+            #skipping geometrically distributed gaps between the edges
+            density = params[0]
+            if density >= 1.0:
+                deps = list(range(i))
+            elif density > 0.0:
+                j = -1
+                while True:
+                    j += 1 + int(math.log(1.0 - rng.random()) / math.log(1.0 - density))
+                    if j >= i:
+                        break
+                    deps.append(j)
+        elif kind == 'powerlaw':
+            num_deps = min(params[0], i)
+            while len(deps) < num_deps:
+                dep = rng.choice(targets)
+                if dep not in deps:
+                    deps.append(dep)
+            targets += deps
+        elif kind == 'layered':
+            layer = i * params[0] // num_modules
+            if layer > 0:
+                below = layers[layer - 1]
+                deps = rng.sample(below, min(params[1], len(below)))
+        if kind == 'powerlaw':
+            targets.append(i)
+        elif kind == 'layered':
+            layer = i * params[0] // num_modules
+            layers[layer] = layers.get(layer, []) + [i]
+        dependencies.append(sorted(deps))
+    return dependencies
+
+#write the dependency graph and print its shape
+def write_topology(dependencies, topology):
+    f = open('pynamic_topology.txt', 'w')
+    depth = []
+    num_edges = 0
+    fan_in = [0] * len(dependencies)
+    for i in range(len(dependencies)):
+        deps = dependencies[i]
+        f.write('libmodule%d:%s\n' %(i, ''.join([' libmodule%d' %(dep) for dep in deps])))
+        num_edges += len(deps)
+        for dep in deps:
+            fan_in[dep] += 1
+        depth.append(1 + max([0] + [depth[dep] for dep in deps]))
+    f.close()
+    if len(dependencies) > 0:
+        print('Pynamic: %s topology with %d edges, max fan-out %d, max fan-in %d, depth %d' %(topology[0], num_edges, max([len(deps) for deps in dependencies]), max(fan_in), max(depth)))
+
+#read a spec written by pynamic_profile.py into the functions, relocations,
+#dependencies and debug info of each module.  The profiled libraries are in
+#dependency order, so only edges to earlier modules are kept to stay acyclic.
+#The text and debug sizes become filler statements and debug records in
+#every function, the data size an initialized array
+def load_spec(filename):
+    f = open(filename, 'r')
+    libraries = json.load(f)['libraries']
+    f.close()
+    index = dict([(libraries[i]['name'], i) for i in range(len(libraries))])
+    spec = []
+    for i in range(len(libraries)):
+        lib = libraries[i]
+        module = {}
+        #every module also defines its extern and init functions
+        module['functions'] = max(1, lib['functions'] - 2)
+        module['relocs'] = lib['relocs']
+        module['needed'] = sorted([index[dep] for dep in lib['needed'] if dep in index and index[dep] < i])
+        module['debug'] = lib['debug'] > 0
+        module['text'] = lib['text']
+        module['data'] = max(0, lib['data'] - lib['relocs'] * spec_reloc_data)
+        module['debug_size'] = lib['debug']
+        #debug records first, as they add text of their own
+        functions = module['functions']
+        text = max(0, lib['text'] - lib['relocs'] * spec_reloc_text) // functions
+        fillers = max(0, text - spec_function_text) // spec_filler_text
+        records = 0
+        if lib['debug'] > 0:
+            records = max(0, lib['debug'] // functions - spec_function_debug - fillers * spec_filler_debug) // spec_record_debug
+        module['records'] = min(records, spec_max_records)
+        module['fillers'] = min(max(0, text - spec_function_text - module['records'] * spec_record_text) // spec_filler_text, spec_max_fillers)
+        spec.append(module)
+    return spec
 
-    if seed == True:
-        random.seed(seedval)
+#the main driver
+def run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, seedval, num_utility_files, avg_num_u_functions, fun_print, name_length, include_dir, CC, processes, use_cache=True, use_pch=True, topology=None, symbol_model='default', bind_mode='default', num_relocs=0, num_tls=0, tls_model='global-dynamic', lang='c', CXX='g++', mangled_length=None, dwarf_version=None, split_dwarf=False, compress_debug='none', rich_debug=False, spec=None, num_pkg_dirs=0, num_decoy_dirs=0, py_modules=None, unwind_chain=0, eh_chain=0, eh_frame_hdr=True):
+
+    num_py_modules = 0
+    if py_modules != None:
+        num_py_modules = py_modules[0]
+    remove_generated_files(num_files - num_utility_files, num_utility_files, use_cache, num_py_modules)
+    if not os.path.isdir(cache_dir):
+        os.mkdir(cache_dir)
+
+    if not split_dwarf:
+        #drop the .dwo files of a previous --split-dwarf build
+        for file in os.listdir('.'):
+            if file.startswith('lib') and file.endswith('.dwo'):
+                os.remove(file)
+    debug = debug_flags(dwarf_version, split_dwarf, compress_debug)
+
+    if seed == False:
+        seedval = random.randint(0, 2**31 - 1)
+    print('Pynamic: random seed = %d' %(seedval))
+
+    #every module is generated from its own random stream, so the signatures
+    #that other modules call are computed up front from the same streams
+    global extern_list
+    global utility_list
+    global dependency_list
+    extern_list = []
+    utility_list = []
+    dependency_list = []
+    if spec != None:
+        #the profiled DT_NEEDED edges replace any --topology
+        extern = True
+        topology = ('spec', [])
+        dependency_list = [module['needed'] for module in spec]
+        write_topology(dependency_list, topology)
+        print('Pynamic: spec with %d libraries, %d functions, %d relocations' %(len(spec), sum([module['functions'] for module in spec]), sum([module['relocs'] for module in spec])))
+        print('Pynamic: spec sizes %d bytes of text, %d of data, %d of debug info, reproduced approximately' %(sum([module['text'] for module in spec]), sum([module['data'] for module in spec]) + sum([module['relocs'] for module in spec]) * spec_reloc_data, sum([module['debug_size'] for module in spec])))
+        capped = [module for module in spec if module['fillers'] == spec_max_fillers or module['records'] == spec_max_records]
+        if len(capped) > 0:
+            print('Pynamic: %d libraries exceed %d filler statements or %d debug records per function and come out smaller' %(len(capped), spec_max_fillers, spec_max_records))
+    elif topology != None:
+        extern = True
+        dependency_list = create_topology(topology, num_files - num_utility_files, seedval)
+        write_topology(dependency_list, topology)
+    elif extern:
+        #-e alone chains each module to the previous one without linking it
+        dependency_list = [[]] + [[i - 1] for i in range(1, num_files - num_utility_files)]
+    if extern:
+        for i in range(num_files - num_utility_files):
+            extern_list += create_function_list(1, module_random(seedval, 'libmodule_extern', i))
+    for i in range(num_utility_files):
+        utility_list.append(create_module_functions(module_random(seedval, 'libutility', i), avg_num_u_functions))
 
     utility_enabled = False
-
-    command = 'rm -f libpynamic.a'
-    run_command(command)
+    utility_symbols = []
+    pool = mp.Pool(processes=processes, initializer=init_generator_worker, initargs=(utility_list, extern_list, dependency_list))
 
     pynamic_header_name = 'pynamic.h'
-    pynamic_header_file = open(pynamic_header_name, 'w')
+    pynamic_header_file = StringIO()
     pynamic_header_file.write('#include <math.h>\n')
-    pool = mp.Pool(processes=processes)
+    mk = StringIO()
     if num_utility_files > 0:
-        global utility_list
-        utility_list = []
         utility_enabled = True
 
         file_prefix = 'libutility'
+        utility_relocs = num_relocs
+        if spec != None:
+            #the utilities are not profiled, give them the average relocations
+            #and the data the modules' relocations point to
+            relocs = [module['relocs'] for module in spec]
+            if max(relocs) > 0:
+                utility_relocs = max(1, sum(relocs) // len(relocs))
+        results = [pool.apply_async(generate_c_file, args=(file_prefix, i, avg_num_u_functions, call_depth, extern, utility_enabled, fun_print, name_length, seedval, symbol_model, utility_relocs, 0, 'c'), kwds={'rich_debug': rich_debug}) for i in range(num_utility_files)]
+        utility_symbols = [p.get()[1] for p in results]
         for i in range(num_utility_files):
-            num_functions = random.randint(avg_num_u_functions/2, avg_num_u_functions*3/2)
             pynamic_header_file.write('#include "' + file_prefix + str(i) + '.h"\n')
-            generate_c_file(file_prefix, i, num_functions, call_depth, extern, utility_enabled, fun_print, name_length)
-        results = [pool.apply_async(compile_file, args=(file_prefix+str(i), i, num_utility_files, include_dir, CC)) for i in range(num_utility_files)]
-        [p.get() for p in results]
-
-    compile_file("libmodulefinal", 0, 0, include_dir, CC)
-    command = 'ar cru libpynamic.a libmodulefinal.o'
-    run_command(command)
-
-    if num_utility_files > 0:
-        command = 'ar cru libpynamic.a '
-        for i in range(num_utility_files):
-            command = '%s %s' %(command, file_prefix+str(i)+'.o')
-        run_command(command)
+            cflags, ldflags, link_deps = library_flags(file_prefix+str(i), symbol_model, bind_mode)
+            compile_file(mk, file_prefix+str(i), [], num_utility_files, include_dir, CC, False, cflags, ldflags, link_deps, debug=debug)
+
+    #the modules are built by CXX in C++ mode, libmodulebegin and
+    #libmodulefinal always by CC
+    module_CC = CC
+    if lang == 'c++':
+        module_CC = CXX
+        write_cxx_header()
+    if use_pch and not pch_supported(module_CC, lang):
+        print('%s cannot build precompiled headers, compiling without them' %(module_CC))
+        use_pch = False
+    if use_pch:
+        compile_pch(mk, num_utility_files, include_dir, module_CC, lang, debug)
+    if not eh_frame_hdr:
+        compile_eh_frame(mk, CC)
+
+    compile_file(mk, "libmodulefinal", [], 0, include_dir, CC, use_pch and lang == 'c', debug=debug)
+
+    pynamic_header_file.write('#ifdef __cplusplus\nextern "C" {\n#endif\n')
     pynamic_header_file.write('void initlibmodulebegin();\n')
     for i in range(num_files - num_utility_files):
         pynamic_header_file.write('void initlibmodule%d();\n' %(i))
     pynamic_header_file.write('void initlibmodulefinal();\n')
-    pynamic_header_file.close()
+    pynamic_header_file.write('#ifdef __cplusplus\n}\n#endif\n')
+    write_if_changed(pynamic_header_name, pynamic_header_file.getvalue())
 
     file_prefix = 'libmodule'
+    results = []
     for i in range(num_files - num_utility_files):
-        num_functions = random.randint(avg_num_functions/2, avg_num_functions*3/2)
-        generate_c_file(file_prefix, i, num_functions, call_depth, extern, utility_enabled, fun_print, name_length)
-    results = [pool.apply_async(compile_file, args=(file_prefix+str(i), i, num_utility_files, include_dir, CC)) for i in range(num_files - num_utility_files)]
-    [p.get() for p in results]
-    if num_files - num_utility_files > 0:
-        command = 'ar cru libpynamic.a '
-        for i in range(num_files - num_utility_files):
-            command = '%s %s' %(command, file_prefix+str(i)+'.o')
-        run_command(command)
-
-    command = 'ranlib libpynamic.a'
-    run_command(command)
-
-    compile_file("libmodulebegin", num_files - num_utility_files, 0, include_dir, CC)
-    command = 'ar cru libpynamic.a libmodulebegin.o'
+        module_relocs = num_relocs
+        options = {'mangled_length': mangled_length, 'rich_debug': rich_debug, 'unwind_hop': unwind_chain > 0, 'eh_hop': eh_chain > 0}
+        if spec != None:
+            module_relocs = spec[i]['relocs']
+            options['num_functions'] = spec[i]['functions']
+            options['num_fillers'] = spec[i]['fillers']
+            options['num_records'] = spec[i]['debug'] and spec[i]['records'] or 0
+            options['spec_data_size'] = spec[i]['data']
+        results.append(pool.apply_async(generate_c_file, args=(file_prefix, i, avg_num_functions, call_depth, extern, utility_enabled, fun_print, name_length, seedval, symbol_model, module_relocs, num_tls, lang), kwds=options))
+    mangled_lengths = []
+    module_symbols = []
+    for p in results:
+        lengths, symbols = p.get()
+        mangled_lengths += lengths
+        module_symbols.append(symbols)
+    pool.close()
+    pool.join()
+    if len(mangled_lengths) > 0:
+        print('Pynamic: %d C++ classes, mangled method names of %d to %d characters, mean %.1f' %(len(mangled_lengths), min(mangled_lengths), max(mangled_lengths), float(sum(mangled_lengths)) / len(mangled_lengths)))
+    for i in range(num_files - num_utility_files):
+        #only --topology records the cross-module calls as DT_NEEDED entries
+        link_modules = []
+        if topology != None:
+            link_modules = dependency_list[i]
+        cflags, ldflags, link_deps = library_flags(file_prefix+str(i), symbol_model, bind_mode)
+        if num_tls > 0:
+            cflags += ' -ftls-model=' + tls_model
+        if not eh_frame_hdr:
+            #the object goes in front of the module's own, see pynamic_eh_frame.c
+            ldflags += ' -Wl,--no-eh-frame-hdr -Wl,--no-ld-generated-unwind-info %s.o' %(eh_frame_name)
+            link_deps = link_deps + [eh_frame_name + '.o']
+        module_debug = debug
+        if spec != None and not spec[i]['debug']:
+            module_debug = '-g0'
+        compile_file(mk, file_prefix+str(i), link_modules, num_utility_files, include_dir, module_CC, use_pch, cflags, ldflags, link_deps, lang, module_debug)
+
+    compile_file(mk, "libmodulebegin", range(num_files - num_utility_files), 0, include_dir, CC, use_pch and lang == 'c', debug=debug)
+
+    #libpynamic.a holds every object, in the order the static pyMPI links them
+    objects = ['libmodulefinal.o']
+    objects += ['libutility%d.o' %(i) for i in range(num_utility_files)]
+    objects += ['libmodule%d.o' %(i) for i in range(num_files - num_utility_files)]
+    objects += ['libmodulebegin.o']
+    targets = [obj[:-2] + '.so' for obj in objects]
+    targets.append(audit_name + '.so')
+    compile_audit(mk, CC)
+    targets.append(dlopen_name)
+    compile_dlopen(mk, CC)
+    write_if_changed('libpynamic.rsp', '\n'.join(objects) + '\n')
+    mk.write('libpynamic.a: %s libpynamic.rsp\n' %(' '.join(objects)))
+    mk.write('\trm -f $@\n')
+    mk.write('\tar cr $@ @libpynamic.rsp\n')
+    mk.write('\tranlib $@\n')
+
+    #the libraries the executables link, in the order of Makefile.mpi4py
+    libs = ['-lmodule%d' %(i) for i in range(num_files - num_utility_files)]
+    libs += ['-lutility%d' %(i) for i in range(num_utility_files)]
+    write_if_changed(libs_rsp_name, '\n'.join(libs) + '\n')
+    lib_files = ['lib%s.so' %(lib[2:]) for lib in libs] + ['libmodulebegin.so', 'libmodulefinal.so']
+    write_if_changed(libs_mk_name, '# Generated by so_generator.py, do not edit\n'
+                     'PYNAMIC_LIB_FILES = %s\n' %(' '.join(lib_files)))
+
+    write_if_changed(makefile_name, '# Generated by so_generator.py, do not edit\n\n'
+                     '.PHONY: all\n'
+                     'all: %s libpynamic.a\n\n' %(' '.join(targets)) + mk.getvalue())
+    command = 'make -f %s -j %d all' %(makefile_name, processes)
     run_command(command)
+    write_dlopen_manifest(utility_symbols, module_symbols, extern and topology == None)
+    if py_modules != None:
+        create_py_modules(py_modules, seedval)
+    create_path_dirs(num_files - num_utility_files, num_pkg_dirs, num_decoy_dirs, num_py_modules)
 
     f = open("pyMPI_initialize.c", "r")
     lines = f.readlines()
@@ -434,6 +2013,27 @@ def run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, see
 
     print('Generating driver...')
 
+    driver_info = ['symbol model = %s' %(symbol_model), 'binding = %s' %(bind_mode)]
+    if num_tls > 0:
+        driver_info.append('%d TLS variables per module, %s model' %(num_tls, tls_model))
+    if lang == 'c++':
+        driver_info.append('C++ modules')
+    if num_pkg_dirs > 0 or num_decoy_dirs > 0:
+        driver_info.append('sys.path = %d decoy directories, then %d package directories' %(num_decoy_dirs, num_pkg_dirs))
+    if unwind_chain > 0:
+        driver_info.append('unwind chain across %d modules' %(unwind_chain))
+    if eh_chain > 0:
+        driver_info.append('exception chain across %d modules' %(eh_chain))
+    if not eh_frame_hdr:
+        driver_info.append('modules without .eh_frame_hdr, unwind tables registered at load')
+    if num_py_modules > 0:
+        driver_info.append('%d Python modules, %d functions, %d classes, %d imports and %d statements each' %tuple(py_modules))
+    if debug != '-g' or rich_debug:
+        info = 'debug info = %s' %(debug)
+        if rich_debug:
+            info += ', rich types'
+        driver_info.append(info)
+
     mpi_wrapper_text = """    import mpi as actual_mpi
     class mpi_wrapper:
         def __init__(self):
@@ -442,10 +2042,14 @@ def run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, see
             self.SUM = actual_mpi.SUM
         def reduce(self, buffer, operation, destination):
             return actual_mpi.reduce(buffer, operation, destination)
+        def gather(self, obj, destination):
+            return actual_mpi.gather([obj], root=destination)
+        def bcast(self, obj, root):
+            return actual_mpi.bcast(obj, root)
         def barrier(self):
-            actual_mpi.barrier
+            actual_mpi.barrier()
 """
-    create_driver(num_files - num_utility_files, "pynamic_driver.py", mpi_wrapper_text)
+    create_driver(num_files - num_utility_files, "pynamic_driver.py", mpi_wrapper_text, driver_info, num_tls, (num_pkg_dirs, num_decoy_dirs), num_py_modules, unwind_chain, eh_chain)
     mpi_wrapper_text = """    from mpi4py import MPI as actual_mpi
     class mpi_wrapper:
         def __init__(self):
@@ -454,19 +2058,27 @@ def run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, see
             self.SUM = actual_mpi.SUM
         def reduce(self, buffer, operation, destination):
             return actual_mpi.COMM_WORLD.reduce(buffer, op=operation, root=destination)
+        def gather(self, obj, destination):
+            return actual_mpi.COMM_WORLD.gather(obj, root=destination)
+        def bcast(self, obj, root):
+            return actual_mpi.COMM_WORLD.bcast(obj, root=root)
         def barrier(self):
             return actual_mpi.COMM_WORLD.Barrier()
 """
-    create_driver(num_files - num_utility_files, "pynamic_driver_mpi4py.py", mpi_wrapper_text)
+    create_driver(num_files - num_utility_files, "pynamic_driver_mpi4py.py", mpi_wrapper_text, driver_info, num_tls, (num_pkg_dirs, num_decoy_dirs), num_py_modules, unwind_chain, eh_chain)
     print('Done!\n')
 
 def print_usage(executable):
     config_options = ''
     if executable == 'config_pynamic.py':
         config_options = '[-c <configure_options>]'
-    print('\nUSAGE:\n\t%s <num_files> <avg_num_functions> [options] %s\n' %(executable, config_options))
+    print('\nUSAGE:\n\t%s <num_files> <avg_num_functions> [options] %s' %(executable, config_options))
+    print('\t%s --spec=<spec_file> [options] %s\n' %(executable, config_options))
     print('\t<num_files> = total number of shared objects to produce')
     print('\t<avg_num_functions> = average number of functions per shared object')
+    print('\t<spec_file> = a library profile written by pynamic_profile.py.  Every')
+    print('\tprofiled library becomes a module with the same number of functions,')
+    print('\tdynamic relocations, DT_NEEDED edges and (no) debug info')
     print('\nOPTIONS:\n')
     if executable == 'config_pynamic.py':
         print('-c <configure_options>')
@@ -477,16 +2089,114 @@ def print_usage(executable):
     print('-d <call_depth>\n\tmaximum Pynamic call stack depth, default = 10\n')
     print('-e\n\tenables external functions to call across modules\n')
     print('-i <python_include_dir>\n\tadd <python_include_dir> when compiling modules\n')
-    print('-j <num_processes>\n\tbuild in parallel with a max of <num_processes> processes\n')
+    print('-j <num_processes>\n\tgenerate and build in parallel with a max of <num_processes> processes\n')
     print('-n <length>\n\tadd <length> characters to the function names\n')
     print('-p\n\tadd a print statement to every generated function\n')
-    print('-s <random_seed>\n\tseed to the random number generator\n')
+    print('-s <random_seed>\n\tseed to the random number generator.  Each module is generated from its')
+    print('\town stream derived from <random_seed>, so the same seed produces the same')
+    print('\tsources regardless of <num_processes>\n')
     print('-u <num_utility_mods> <avg_num_u_functions>')
     print('\tcreate <num_utility_mods> math library-like utility modules')
     print('\twith an average of <avg_num_u_functions> functions')
     print('\tNOTE: Number of python modules = <num_files> - <avg_num_u_functions>\n')
+    print('--topology=<type>[:<params>]')
+    print('\tgenerate cross-module calls along a dependency graph and link each module')
+    print('\tagainst the modules it calls (DT_NEEDED); implies -e.  <type> is one of')
+    print('\t  chain              module i depends on module i-1')
+    print('\t  tree[:<fanout>]    a tree with <fanout> children per module, default 2')
+    print('\t  dag[:<density>]    each earlier module is a dependency with probability')
+    print('\t                     <density>, default 0.01')
+    print('\t  powerlaw[:<m>]     scale-free graph, each module depends on <m> earlier')
+    print('\t                     modules picked by preferential attachment, default 2')
+    print('\t  layered[:<layers>,<m>]  <layers> layers, each module depends on <m>')
+    print('\t                     modules of the layer below, default 4,2')
+    print('\tthe graph is written to pynamic_topology.txt\n')
+    print('--relocs=<num_relocs>')
+    print('\tadd about <num_relocs> data relocations to every generated library: a')
+    print('\tfunction pointer table, vtable-like structs in .data.rel.ro and pointers')
+    print('\tto data exported by the utility (or, with --topology, dependency) libraries\n')
+    print('--tls=<num_vars>')
+    print('\tgive every module <num_vars> thread-local variables, alternating between')
+    print('\tinitialized (.tdata) and zero (.tbss), that its functions update.  The')
+    print('\tdriver reports modules that fail to load and the TLS access time\n')
+    print('--tls-model=<model>')
+    print('\tTLS access model used with --tls: global-dynamic (default), local-dynamic')
+    print('\tor initial-exec\n')
+    print('--lang=<lang>')
+    print('\tlanguage of the Python modules, c (default) or c++.  C++ modules add')
+    print('\tclasses with vtables and typeinfo in per-module namespaces, virtual')
+    print('\tdispatch, and template instantiations shared across libraries.  The')
+    print('\tutility libraries stay C\n')
+    print('--mangled-length=<median>[:<sigma>]')
+    print('\twith --lang=c++, draw the length of each class\'s mangled method names')
+    print('\tfrom a log-normal distribution with <median> and shape <sigma>,')
+    print('\tdefault 0.5\n')
+    print('--dwarf=<version>')
+    print('\temit DWARF <version> (2 to 5) debug info instead of the compiler default\n')
+    print('--split-dwarf')
+    print('\tcompile with -gsplit-dwarf, keeping most debug info in a .dwo file next')
+    print('\tto each object\n')
+    print('--compress-debug=<type>')
+    print('\tcompress the debug sections of every object and library with <type>,')
+    print('\tnone (default), zlib or zstd\n')
+    print('--rich-debug')
+    print('\tadd nested struct, union, enum and typedef types, always inlined')
+    print('\thelpers and lexical blocks to every generated function so the debug info')
+    print('\tof a library resembles that of real code\n')
+    print('--pkg-dirs=<num_dirs>')
+    print('\tspread the modules over <num_dirs> directories in %s that the driver' %(path_dir))
+    print('\tsearches instead of the build directory\n')
+    print('--decoy-dirs=<num_dirs>')
+    print('\tmake the driver search <num_dirs> directories without modules first.')
+    print('\tWith either option the driver reports the stat and listdir calls of')
+    print('\tthe imports on every rank\n')
+    print('--py-modules=<num_modules>[:<functions>,<classes>,<imports>,<statements>]')
+    print('\talso generate <num_modules> pure Python modules %s<i>.py with an average' %(py_module_prefix))
+    print('\tof <functions> functions and <statements> statements per function, a')
+    print('\thierarchy of <classes> classes and imports of <imports> earlier modules,')
+    print('\tdefault %s.  The modules are compiled to .pyc files, and' %(','.join([str(v) for v in py_module_defaults])))
+    print('\tthe driver imports and visits them after the extension modules\n')
+    print('--unwind-chain=<num_hops>')
+    print('\tgive every module a hop function and make the driver call a chain of')
+    print('\t<num_hops> hops, each in the next module (wrapping around), whose last')
+    print('\thop times backtrace().  The driver reports the first and steady-state')
+    print('\tbacktrace time and the number of frames\n')
+    print('--eh-chain=<num_hops>')
+    print('\twith --lang=c++, make the driver call a chain of <num_hops> hops, each')
+    print('\tin the next module (wrapping around), whose last hop throws a C++')
+    print('\texception that the first one catches.  The driver reports the first and')
+    print('\tsteady-state throw-to-catch time\n')
+    print('--no-eh-frame-hdr')
+    print('\twith --lang=c++, link the modules without .eh_frame_hdr and its lookup')
+    print('\ttable.  Each module registers its unwind tables when it loads, and the')
+    print('\tunwinder searches the registered tables on every throw\n')
+    print('--bind=<mode>')
+    print('\thow the generated libraries bind their symbols, one of')
+    print('\t  default  the linker and loader default')
+    print('\t  lazy     link with -z lazy, binding functions on first call')
+    print('\t  now      link with -z now, binding everything at load time')
+    print('\t  noplt    compile with -fno-plt, calling through the GOT')
+    print('\tthe driver reports the mode and, per rank, the import, first visit and')
+    print('\tsecond visit times.  LD_BIND_NOW=1 at run time forces immediate binding\n')
+    print('--symbol-model=<model>')
+    print('\tsymbol visibility and binding of the generated libraries, one of')
+    print('\t  default           every function is an exported, interposable global')
+    print('\t  hidden            -fvisibility=hidden, exporting only the module init')
+    print('\t                    functions, -e externs and utility functions')
+    print('\t  symbolic          link with -Bsymbolic')
+    print('\t  no-interposition  compile with -fno-semantic-interposition')
+    print('\t  version-script    export the same symbols as hidden with a linker')
+    print('\t                    version script')
+    print('\tthe driver reports the model next to its import and visit times\n')
+    print('--no-pch')
+    print('\tdo not precompile Python.h and the utility headers for the modules\n')
+    print('--no-cache')
+    print('\trebuild every module instead of reusing the ones whose source and')
+    print('\tcompile commands are unchanged since the previous run\n')
     print('--with-cc=<command>')
     print('\tuse the C compiler located at <command> to build Pynamic modules.\n')
+    print('--with-cxx=<command>')
+    print('\tuse the C++ compiler located at <command> to build --lang=c++ modules.\n')
     print('--with-python=<command>')
     print('--with-mpi4py')
     print('\tBuild with mpi4py. Default on Python3+')
@@ -507,8 +2217,16 @@ def parse_and_run(executable):
     #parse and extract command line args
     exit = 0
     try:
-        num_files = int(sys.argv[1])
-        avg_num_functions = int(sys.argv[2])
+        spec = None
+        first_option = 3
+        if sys.argv[1].find('--spec=') == 0:
+            spec = load_spec(sys.argv[1][7:])
+            num_files = len(spec)
+            avg_num_functions = sum([module['functions'] for module in spec]) // max(1, len(spec))
+            first_option = 2
+        else:
+            num_files = int(sys.argv[1])
+            avg_num_functions = int(sys.argv[2])
         num_utility_files = 0
         avg_num_u_functions = 0
         call_depth = 10
@@ -524,6 +2242,26 @@ def parse_and_run(executable):
         configure_args = []
         python_command = sys.executable
         processes = 1
+        use_cache = True
+        use_pch = True
+        topology = None
+        symbol_model = 'default'
+        bind_mode = 'default'
+        num_relocs = 0
+        num_tls = 0
+        tls_model = 'global-dynamic'
+        lang = 'c'
+        mangled_length = None
+        dwarf_version = None
+        split_dwarf = False
+        compress_debug = 'none'
+        rich_debug = False
+        num_pkg_dirs = 0
+        num_decoy_dirs = 0
+        py_modules = None
+        unwind_chain = 0
+        eh_chain = 0
+        eh_frame_hdr = True
         if sys.version_info.major > 2:
             use_mpi4py = True
             
@@ -531,8 +2269,12 @@ def parse_and_run(executable):
             CC = os.environ['CC']
         except:
             CC = 'gcc'
+        try:
+            CXX = os.environ['CXX']
+        except:
+            CXX = 'g++'
 
-        for i in range(3, len(sys.argv)):
+        for i in range(first_option, len(sys.argv)):
             if next == 0:
                 if sys.argv[i] == '-b':
                     bigexe = True
@@ -567,8 +2309,69 @@ def parse_and_run(executable):
                 elif sys.argv[i] == '-c':
                     configure_args += sys.argv[i+1:]
                     next = 99999
+                elif sys.argv[i].find('--topology=') != -1:
+                    topology = parse_topology(sys.argv[i][11:])
+                elif sys.argv[i].find('--relocs=') != -1:
+                    num_relocs = int(sys.argv[i][9:])
+                elif sys.argv[i].find('--tls=') != -1:
+                    num_tls = int(sys.argv[i][6:])
+                elif sys.argv[i].find('--tls-model=') != -1:
+                    tls_model = sys.argv[i][12:]
+                    if tls_model not in tls_models:
+                        raise ValueError('unknown TLS model %s' %(tls_model))
+                elif sys.argv[i].find('--lang=') != -1:
+                    lang = sys.argv[i][7:]
+                    if lang not in langs:
+                        raise ValueError('unknown language %s' %(lang))
+                elif sys.argv[i].find('--mangled-length=') != -1:
+                    fields = sys.argv[i][17:].split(':')
+                    mangled_length = (int(fields[0]), 0.5)
+                    if len(fields) > 1:
+                        mangled_length = (int(fields[0]), float(fields[1]))
+                elif sys.argv[i].find('--dwarf=') != -1:
+                    dwarf_version = int(sys.argv[i][8:])
+                    if dwarf_version not in dwarf_versions:
+                        raise ValueError('unsupported DWARF version %d' %(dwarf_version))
+                elif sys.argv[i] == '--split-dwarf':
+                    split_dwarf = True
+                elif sys.argv[i].find('--compress-debug=') != -1:
+                    compress_debug = sys.argv[i][17:]
+                    if compress_debug not in debug_compressions:
+                        raise ValueError('unknown debug compression %s' %(compress_debug))
+                elif sys.argv[i] == '--rich-debug':
+                    rich_debug = True
+                elif sys.argv[i].find('--pkg-dirs=') != -1:
+                    num_pkg_dirs = int(sys.argv[i][11:])
+                elif sys.argv[i].find('--decoy-dirs=') != -1:
+                    num_decoy_dirs = int(sys.argv[i][13:])
+                elif sys.argv[i].find('--py-modules=') != -1:
+                    py_modules = parse_py_modules(sys.argv[i][13:])
+                elif sys.argv[i].find('--unwind-chain=') != -1:
+                    unwind_chain = int(sys.argv[i][15:])
+                    if unwind_chain < 1:
+                        raise ValueError('--unwind-chain needs at least one module')
+                elif sys.argv[i].find('--eh-chain=') != -1:
+                    eh_chain = int(sys.argv[i][11:])
+                    if eh_chain < 1:
+                        raise ValueError('--eh-chain needs at least one module')
+                elif sys.argv[i] == '--no-eh-frame-hdr':
+                    eh_frame_hdr = False
+                elif sys.argv[i].find('--bind=') != -1:
+                    bind_mode = sys.argv[i][7:]
+                    if bind_mode not in bind_modes:
+                        raise ValueError('unknown binding mode %s' %(bind_mode))
+                elif sys.argv[i].find('--symbol-model=') != -1:
+                    symbol_model = sys.argv[i][15:]
+                    if symbol_model not in symbol_models:
+                        raise ValueError('unknown symbol model %s' %(symbol_model))
+                elif sys.argv[i] == '--no-pch':
+                    use_pch = False
+                elif sys.argv[i] == '--no-cache':
+                    use_cache = False
                 elif sys.argv[i].find('--with-cc=') != -1:
                     CC = sys.argv[i][10:]
+                elif sys.argv[i].find('--with-cxx=') != -1:
+                    CXX = sys.argv[i][11:]
                 elif sys.argv[i].find('--with-python=') != -1:
                     configure_args.append(sys.argv[i])
                     python_command = sys.argv[i][14:]
@@ -582,6 +2385,15 @@ def parse_and_run(executable):
             else:
                 next = next - 1
 
+        if spec != None:
+            num_files += num_utility_files
+
+        if topology != None and topology[0] == 'layered' and topology[1][0] > num_files - num_utility_files:
+            raise ValueError('topology %s has more layers than the %d modules' %(topology[0], num_files - num_utility_files))
+
+        if (eh_chain > 0 or not eh_frame_hdr) and lang != 'c++':
+            raise ValueError('--eh-chain and --no-eh-frame-hdr need --lang=c++')
+
         if include_dir == '':
             # try to automatically find include directory for default python
             include_dir = get_paths()['include']
@@ -597,18 +2409,23 @@ def parse_and_run(executable):
         print('#############################')
         print_usage(executable)
         
-    run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, seedval, num_utility_files, avg_num_u_functions, fun_print, name_length, include_dir, CC, processes)
+    run_so_generator(num_files, avg_num_functions, call_depth, extern, seed, seedval, num_utility_files, avg_num_u_functions, fun_print, name_length, include_dir, CC, processes, use_cache, use_pch, topology, symbol_model, bind_mode, num_relocs, num_tls, tls_model, lang, CXX, mangled_length, dwarf_version, split_dwarf, compress_debug, rich_debug, spec, num_pkg_dirs, num_decoy_dirs, py_modules, unwind_chain, eh_chain, eh_frame_hdr)
+
+    if lang == 'c++':
+        #the static pyMPI links libpynamic.a, whose C++ objects need libstdc++
+        try:
+            os.environ['LIBS'] += ' -lstdc++'
+        except:
+            os.environ['LIBS'] = '-lstdc++'
 
     if use_mpi4py:
-        os.environ["NUM_UTILITIES"] = str(num_utility_files)
-        os.environ["NUM_MODULES"] = str(num_files - num_utility_files)
         os.environ["PYTHON_EXE"] = python_command
 
     return configure_args, python_command, bigexe, use_mpi4py, processes
 
 #MAIN FUNCTION
 if __name__ == '__main__':
-    if len(sys.argv) < 3:
+    if len(sys.argv) < 3 and (len(sys.argv) < 2 or sys.argv[1].find('--spec=') != 0):
         print_usage('python so_generator.py')
     parse_and_run('python so_generator.py')
 